@@ -0,0 +1,8 @@
+#!/bin/sh
+# Builds the benchmarks on Linux, into build/benchmark. Needs a C++11 compiler and the SDL2 and OpenGL development packages.
+# Run it from the repo root, since some benchmarks read files from img.
+set -e
+# The code includes SDL as "SDL/SDL.h", so the SDL2 headers are linked into a folder with that name
+mkdir -p build/include
+ln -sfn "$(sdl2-config --prefix)/include/SDL2" build/include/SDL
+g++ -O2 -std=c++11 -Ibuild/include src/benchmark.cpp -o build/benchmark $(sdl2-config --libs) -lGL -lpthread
@@ -0,0 +1,9 @@
+#!/bin/sh
+# Builds the embeddable library on Linux, into build/libinputdisplaylist.so. Its interface is src/inputdisplaylist.h.
+# Needs a C++11 compiler and the SDL2 and OpenGL development packages.
+set -e
+# The code includes SDL as "SDL/SDL.h", so the SDL2 headers are linked into a folder with that name
+mkdir -p build/include
+ln -sfn "$(sdl2-config --prefix)/include/SDL2" build/include/SDL
+# Only the idl functions are exported, so the library's internals can't clash with the program using it
+g++ -O2 -std=c++11 -fPIC -shared -fvisibility=hidden -Ibuild/include src/inputdisplaylist.cpp -o build/libinputdisplaylist.so $(sdl2-config --libs) -lGL -lpthread
@@ -0,0 +1,67 @@
+#include <new>
+#include <cstdlib>
+
+// Counts heap allocations made through new, so the frame loop can be checked for allocating.
+// Allocations in the steady state cause frame time spikes, so --stats shows how many the last frame made,
+// and the frame benchmark fails if there are any.
+// Each thread counts its own, since background loads allocate freely without affecting frames.
+// Allocations made with malloc, like those inside SDL and the drivers, aren't counted.
+//
+// This replaces the global operator new and delete, so include it in exactly one source file.
+
+thread_local uint64 threadAllocationCount = 0;
+
+uint64 getThreadAllocationCount()
+{
+	return threadAllocationCount;
+}
+
+void* countedAllocate(size_t size)
+{
+	++threadAllocationCount;
+	void* result = malloc(size ? size : 1);
+	if (!result) throw std::bad_alloc();
+	return result;
+}
+
+void* operator new(size_t size)
+{
+	return countedAllocate(size);
+}
+
+void* operator new[](size_t size)
+{
+	return countedAllocate(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	++threadAllocationCount;
+	return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	++threadAllocationCount;
+	return malloc(size ? size : 1);
+}
+
+void operator delete(void* pointer) noexcept
+{
+	free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+	free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+	free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+	free(pointer);
+}
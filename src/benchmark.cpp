@@ -0,0 +1,403 @@
+// Benchmarks for the core functions. Runs without a window or OpenGL context, so it works on a headless machine.
+// Results are printed to stdout as one JSON object per line, and as a table to stderr.
+// Exits with 1 if the steady state frame benchmark allocated any memory.
+//
+// Options:
+//   --filter <text>   only run benchmarks whose name contains the text
+//   --samples <n>     number of timed samples per benchmark (default 25)
+#include "platform.h"
+#include "graphics.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include "allocations.h"
+#include "trace.h"
+#include "latency.h"
+#include "jobs.h"
+#include "imagecache.h"
+#include "textures.h"
+#include "motion.h"
+#include "config.h"
+#include "inputlist.h"
+
+struct BenchmarkOptions
+{
+	const char* filter;
+	uint sampleCount;
+};
+
+// Keeps the compiler from optimizing away results
+volatile uint64 benchmarkSink;
+
+// Run body(iterations) repeatedly and report the time per iteration.
+// The iteration count is raised until a sample takes at least 5ms, so timer resolution doesn't matter,
+// and the median of the samples is used as the main result since it isn't thrown off by the odd slow sample.
+template <typename Body>
+void runBenchmark(const BenchmarkOptions& options, const std::string& name, Body body)
+{
+	if (options.filter && name.find(options.filter) == std::string::npos) return;
+
+	uint64 iterations = 1;
+	while (true) {
+		uint64 start = getMicroseconds();
+		body(iterations);
+		uint64 elapsed = getMicroseconds() - start;
+		if (elapsed >= 5000 || iterations >= (1ull << 40)) break;
+		iterations *= elapsed < 500 ? 10 : 2;
+	}
+
+	std::vector<double> samples(options.sampleCount);
+	forloop(i, options.sampleCount)
+	{
+		uint64 start = getMicroseconds();
+		body(iterations);
+		samples[i] = (getMicroseconds() - start) * 1000.0 / iterations;
+	}
+	std::sort(samples.begin(), samples.end());
+	double mean = 0;
+	forloop(i, samples.size())
+	{
+		mean += samples[i];
+	}
+	mean /= samples.size();
+	double variance = 0;
+	forloop(i, samples.size())
+	{
+		variance += (samples[i] - mean) * (samples[i] - mean);
+	}
+	double deviation = samples.size() > 1 ? sqrt(variance / (samples.size()-1)) : 0;
+	double median = samples[samples.size()/2];
+
+	printf("{\"name\":\"%s\",\"iterations\":%llu,\"samples\":%u,\"min_ns\":%.2f,\"median_ns\":%.2f,\"mean_ns\":%.2f,\"stddev_ns\":%.2f,\"max_ns\":%.2f}\n",
+		name.c_str(), iterations, options.sampleCount, samples.front(), median, mean, deviation, samples.back());
+	fflush(stdout);
+	fprintf(stderr, "%-40s %12.1f ns  (min %.1f, max %.1f, stddev %.1f)\n", name.c_str(), median, samples.front(), samples.back(), deviation);
+}
+
+// Joystick states with random buttons, hats and axes, for checkInputAction to test against
+void makeRandomJoystickStates(std::vector<Input::Joystick::State>* out, uint count)
+{
+	uint random = 12345;
+	out->resize(count);
+	forloop(i, count)
+	{
+		Input::Joystick::State* state = &(*out)[i];
+		forloop(button, Input::Joystick::State::buttonCount)
+		{
+			random = random*1103515245 + 12345;
+			state->buttons[button] = (random >> 16) & 1;
+		}
+		forloop(axis, Input::Joystick::State::axisCount)
+		{
+			random = random*1103515245 + 12345;
+			state->axes[axis] = ((random >> 16) & 0xFFFF) / 32767.5f - 1;
+		}
+		random = random*1103515245 + 12345;
+		state->hat = (random >> 16) & 0xF;
+	}
+}
+
+void benchmarkCheckInputAction(const BenchmarkOptions& options)
+{
+	std::vector<Input::Joystick::State> states;
+	makeRandomJoystickStates(&states, 256);
+
+	InputAction actions[3];
+	actions[0].type = InputAction::Type_button;
+	actions[0].button.buttonIndex = 5;
+	actions[1].type = InputAction::Type_hat;
+	actions[1].hat.pov = SDL_HAT_LEFT;
+	actions[2].type = InputAction::Type_axis;
+	actions[2].axis.axisIndex = 1;
+	actions[2].axis.restPosition = 0;
+	actions[2].axis.triggerPosition = -0.5f;
+	const char* names[3] ={"button", "hat", "axis"};
+
+	forloop(actionIndex, 3)
+	{
+		InputAction action = actions[actionIndex];
+		runBenchmark(options, std::string("checkInputAction/") + names[actionIndex], [&](uint64 iterations) {
+			uint64 active = 0;
+			for (uint64 i=0; i<iterations; ++i) {
+				active += checkInputAction(states[i & 255], action);
+			}
+			benchmarkSink = active;
+		});
+	}
+}
+
+void benchmarkAddInputToList(const BenchmarkOptions& options)
+{
+	uint capacities[] ={10, 100, 1000};
+	forloop(capacityIndex, 3)
+	{
+		uint capacity = capacities[capacityIndex];
+		TextureCache textures;
+		uint image = acquireTexture(&textures, "benchmark.png");
+		InputDisplayList list ={};
+		uint frameNumber = 0;
+		// Start from a full list, since that's where it spends its time
+		forloop(i, capacity)
+		{
+			addInputToList(&list, &textures, image, frameNumber++, 0, capacity);
+		}
+		char name[64];
+		snprintf(name, sizeof(name), "addInputToList/capacity=%u", capacity);
+		runBenchmark(options, name, [&](uint64 iterations) {
+			for (uint64 i=0; i<iterations; ++i) {
+				// Two inputs per frame, so groups are counted too
+				addInputToList(&list, &textures, image, frameNumber, 0, capacity);
+				frameNumber += i & 1;
+			}
+		});
+		while (list.inputs.size()) {
+			dropLastInput(&list, &textures);
+		}
+		releaseTexture(&textures, image);
+	}
+}
+
+// Layout is everything renderInputList does apart from the draw calls, which need a GL context
+void benchmarkInputLayout(const BenchmarkOptions& options)
+{
+	struct LayoutCase { uint listSize; int windowWidth, windowHeight; };
+	LayoutCase cases[] ={{100, 600, 100}, {1000, 600, 100}, {1000, 100, 4000}};
+	forloop(caseIndex, 3)
+	{
+		LayoutCase layoutCase = cases[caseIndex];
+		TextureCache textures;
+		uint image = acquireTexture(&textures, "benchmark.png");
+		InputDisplayList list ={};
+		forloop(i, layoutCase.listSize)
+		{
+			addInputToList(&list, &textures, image, i/2, 0, layoutCase.listSize);
+		}
+		InputLayout layout ={};
+		char name[96];
+		snprintf(name, sizeof(name), "updateInputLayout/list=%u,window=%dx%d", layoutCase.listSize, layoutCase.windowWidth, layoutCase.windowHeight);
+		runBenchmark(options, name, [&](uint64 iterations) {
+			for (uint64 i=0; i<iterations; ++i) {
+				layout.valid = false;
+				updateInputLayout(&layout, list, textures, 48, 48, layoutCase.windowWidth, layoutCase.windowHeight);
+			}
+			benchmarkSink = layout.quads.size();
+		});
+		while (list.inputs.size()) {
+			dropLastInput(&list, &textures);
+		}
+		releaseTexture(&textures, image);
+	}
+}
+
+// A positional config with the six settings followed by mappings, lineCount lines in all
+std::string generateConfig(uint lineCount)
+{
+	std::string result = "true\ntrue\n0 0 0\n48\n48\n100\n";
+	const char* mappings[] ={
+		"d left img/left.png", "b 0 img/lp.png", "b 3 img/mp.png (a comment)", "h left left", "a 0 0 -0.5 left", "a 1 0 0.5 img/hp.png",
+	};
+	for (uint line=6; line<lineCount; ++line) {
+		result += mappings[line % 6];
+		result += '\n';
+	}
+	return result;
+}
+
+void benchmarkParseConfigFile(const BenchmarkOptions& options)
+{
+	uint lineCounts[] ={10, 100, 1000, 10000};
+	forloop(i, 4)
+	{
+		std::string text = generateConfig(lineCounts[i]);
+		const char* path = "benchmark_config.txt";
+		FILE* file = fopen(path, "wb");
+		if (!file) return;
+		fwrite(text.data(), 1, text.size(), file);
+		fclose(file);
+		char name[64];
+		snprintf(name, sizeof(name), "parseConfigFile/lines=%u", lineCounts[i]);
+		runBenchmark(options, name, [&](uint64 iterations) {
+			for (uint64 i=0; i<iterations; ++i) {
+				ConfigSet config;
+				std::vector<ConfigError> errors;
+				parseConfigFile(&config, path, &errors);
+				benchmarkSink = config.profiles[0].inputMaps.size();
+			}
+		});
+		remove(path);
+	}
+}
+
+// Decoding is the part of loading a texture that doesn't need a GL context
+void benchmarkImageDecode(const BenchmarkOptions& options)
+{
+	const char* path = "img/lp.png";
+	std::vector<unsigned char> file;
+	if (!readEntireFile(path, &file)) {
+		fprintf(stderr, "skipping image decode: couldn't read %s\n", path);
+		return;
+	}
+	runBenchmark(options, "loadImageFromMemory/img/lp.png", [&](uint64 iterations) {
+		for (uint64 i=0; i<iterations; ++i) {
+			Image image;
+			if (loadImageFromMemory(&image, file.data(), file.size())) {
+				benchmarkSink = image.width;
+				freeImage(&image);
+			}
+		}
+	});
+}
+
+// Motions made of random steps, each ending in a button, in the key = value format
+std::string generateMotionConfig(uint motionCount)
+{
+	std::string result;
+	uint random = 12345;
+	forloop(i, motionCount)
+	{
+		result += "motion";
+		forloop(step, 3 + i%4)
+		{
+			random = random*1103515245 + 12345;
+			char direction[4];
+			snprintf(direction, sizeof(direction), " %u", 1 + (random >> 16)%9);
+			result += direction;
+		}
+		char rest[64];
+		snprintf(rest, sizeof(rest), " button %u within 30 leniency %u = img/motion%u.png\n", i%6, i%3, i);
+		result += rest;
+	}
+	return result;
+}
+
+// Feeding a symbol should cost the same however many motions there are
+void benchmarkFeedMotionInput(const BenchmarkOptions& options)
+{
+	uint motionCounts[] ={10, 100, 1000};
+	forloop(countIndex, 3)
+	{
+		std::string text = generateMotionConfig(motionCounts[countIndex]);
+		ConfigSet config;
+		std::vector<ConfigError> errors;
+		parseConfigText(&config, text.data(), text.size(), &errors);
+		const MotionRecognizer& recognizer = config.profiles[0].motionRecognizer;
+		// Random directions and the six buttons the motions use
+		std::vector<uint> symbols(256);
+		uint random = 54321;
+		forloop(i, symbols.size())
+		{
+			random = random*1103515245 + 12345;
+			uint symbol = (random >> 16) % 15;
+			symbols[i] = symbol < 9 ? symbol : getButtonSymbol(symbol-9);
+		}
+		MotionState state ={0};
+		char name[64];
+		snprintf(name, sizeof(name), "feedMotionInput/motions=%u", motionCounts[countIndex]);
+		runBenchmark(options, name, [&](uint64 iterations) {
+			uint64 matches = 0;
+			for (uint64 i=0; i<iterations; ++i) {
+				matches += feedMotionInput(&state, recognizer, symbols[i & 255], (uint)i) != 0;
+			}
+			benchmarkSink = matches;
+		});
+	}
+}
+
+// The per-frame work of the main loop, apart from polling and drawing: mapping two joysticks' inputs and motions,
+// adding them to a full list, and laying it out. Returns false if any of it allocated memory.
+bool benchmarkFrame(const BenchmarkOptions& options)
+{
+	const char* configText =
+		"maxDisplayedInputs = 100\n"
+		"direction left = img/left.png\n" "direction right = img/right.png\n" "direction up = img/up.png\n"
+		"direction down = img/down.png\n" "direction upleft = img/upleft.png\n" "direction upright = img/upright.png\n"
+		"direction downleft = img/downleft.png\n" "direction downright = img/downright.png\n" "direction center = img/center.png\n"
+		"button 0 = img/lp.png\n" "button 3 = img/mp.png\n" "button 5 = img/hp.png\n"
+		"button 1 = img/lk.png\n" "button 2 = img/mk.png\n" "button 7 = img/hk.png\n"
+		"hat left = left\n" "hat right = right\n" "hat up = up\n" "hat down = down\n"
+		"axis 0 0 -0.5 = left\n" "axis 0 0 0.5 = right\n" "axis 1 0 0.5 = down\n" "axis 1 0 -0.5 = up\n"
+		"motion 2 3 6 button 0 within 12 = img/qcf.png\n" "motion 6 2 3 button 0 within 12 leniency 1 = img/dp.png\n";
+	ConfigSet config;
+	std::vector<ConfigError> errors;
+	parseConfigText(&config, configText, strlen(configText), &errors);
+	Config* profile = &config.profiles[0];
+
+	// Images are marked as loaded without pixels, so nothing is loaded or uploaded
+	TextureCache textures;
+	JobQueue jobs;
+	startJobQueue(&jobs);
+	profile->images.resize(profile->imagePaths.size());
+	forloop(i, profile->imagePaths.size())
+	{
+		profile->images[i] = acquireDecodedTexture(&textures, profile->imagePaths[i], i+1, Image());
+	}
+
+	std::vector<Input::Joystick::State> states;
+	makeRandomJoystickStates(&states, 256);
+	Input input ={0};
+	input.joystickCount = 2;
+	input.joysticks = new Input::Joystick[input.joystickCount];
+	forloop(i, input.joystickCount)
+	{
+		input.joysticks[i].current = states[i];
+		input.joysticks[i].profile = 0;
+	}
+	PlayerInputs player = PlayerInputs();
+	InputLayout layout ={};
+	uint frameNumber = 0;
+	auto runFrames = [&](uint64 frameCount) {
+		for (uint64 frame=0; frame<frameCount; ++frame) {
+			forloop(i, input.joystickCount)
+			{
+				input.joysticks[i].previous = input.joysticks[i].current;
+				input.joysticks[i].current = states[(frameNumber*3 + i*17) & 255];
+			}
+			recordPlayerInputs(&player, 1, input, *profile, &textures, &jobs, frameNumber);
+			updateInputLayout(&layout, player.list, textures, 48, 48, 600, 100);
+			++frameNumber;
+		}
+	};
+	// Fill the list and let every buffer reach its final size first
+	runFrames(1000);
+
+	uint64 allocations = 0;
+	runBenchmark(options, "frame/2 joysticks,list=100", [&](uint64 iterations) {
+		uint64 startAllocations = getThreadAllocationCount();
+		runFrames(iterations);
+		allocations += getThreadAllocationCount() - startAllocations;
+	});
+
+	while (player.list.inputs.size()) {
+		dropLastInput(&player.list, &textures);
+	}
+	delete[] input.joysticks;
+	releaseConfigImages(&config, &textures);
+	stopJobQueue(&jobs);
+	if (allocations) {
+		fprintf(stderr, "FAILED: the steady state frame made %llu heap allocations\n", allocations);
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkOptions options ={0};
+	options.sampleCount = 25;
+	for (int i=1; i<argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--filter" && i+1 < argc) options.filter = argv[++i];
+		else if (arg == "--samples" && i+1 < argc) options.sampleCount = std::max(1, atoi(argv[++i]));
+	}
+
+	benchmarkCheckInputAction(options);
+	benchmarkAddInputToList(options);
+	benchmarkInputLayout(options);
+	benchmarkParseConfigFile(options);
+	benchmarkImageDecode(options);
+	benchmarkFeedMotionInput(options);
+	bool frameAllocationFree = benchmarkFrame(options);
+	return frameAllocationFree ? 0 : 1;
+}
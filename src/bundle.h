@@ -0,0 +1,463 @@
+// A config with all of its images already decoded, in one file that can be mapped and uploaded
+// without any parsing or decoding. Made with --bake, and loaded in place of a config file.
+//
+// Layout: BundleHeader, BundleProfile[], then for each profile its name, joystick names, InputMapping[],
+// DirectionMapping[], image indices and compiled motions, then BundleImage[], image paths, and pixel data.
+// Images are stored once no matter how many profiles use them.
+// Mappings are stored as raw structs, so a bundle can only be loaded by the build that baked it.
+
+struct BundleHeader
+{
+	static const uint expectedMagic = 0x42444449; // "IDDB"
+	static const uint expectedVersion = 5;
+	uint magic;
+	uint version;
+	// Guards against loading a bundle from a build with different struct layouts
+	uint inputMappingSize;
+	uint directionMappingSize;
+	uint motionMatchSize;
+
+	uint profileCount;
+	// Unique image paths across all profiles
+	uint imageCount;
+	uint64 profilesOffset;
+	uint64 imagesOffset;
+	uint64 fileSize;
+};
+
+struct BundleProfile
+{
+	Color backgroundColor;
+	uint alwaysOnTop;
+	uint transparentBackground;
+	uint imageWidth;
+	uint imageHeight;
+	uint maxDisplayedInputs;
+	uint hotkey;
+
+	uint inputMapCount;
+	uint directionMapCount;
+	// One per Config::imagePaths entry, each an index into the BundleImage array
+	uint imageCount;
+	uint joystickCount;
+	uint motionStateCount;
+	uint motionMatchCount;
+	uint64 nameOffset;
+	// Null terminated strings, one after the other
+	uint64 joysticksOffset;
+	uint64 inputMapsOffset;
+	uint64 directionMapsOffset;
+	uint64 imageIndicesOffset;
+	// The MotionRecognizer's arrays, so motions don't have to be compiled again
+	uint64 motionTransitionsOffset;
+	uint64 motionMatchStartsOffset;
+	uint64 motionMatchesOffset;
+};
+
+struct BundleImage
+{
+	uint64 contentHash;
+	// Offsets from the start of the file. Images with the same contents share pixels.
+	uint64 pathOffset;
+	uint64 pixelsOffset;
+	uint width;
+	uint height;
+};
+
+bool isBundleFile(const char* filePath)
+{
+	uint magic = 0;
+	FILE* file = fopen(filePath, "rb");
+	if (!file) return false;
+	bool read = fread(&magic, sizeof(magic), 1, file) == 1;
+	fclose(file);
+	return read && magic == BundleHeader::expectedMagic;
+}
+
+uint64 alignOffset(uint64 offset, uint64 alignment)
+{
+	return (offset + alignment-1) / alignment * alignment;
+}
+
+// Parse a config file, decode its images in parallel and write everything to one bundle file.
+// Fails without writing anything if the config has errors, which are printed.
+bool bakeBundle(const char* configPath, const char* bundlePath, JobQueue* jobs)
+{
+	ConfigSet config;
+	std::vector<ConfigError> errors;
+	parseConfigFile(&config, configPath, &errors);
+	if (errors.size()) {
+		fprintf(stderr, "%s", formatConfigErrors(configPath, errors).c_str());
+		return false;
+	}
+
+	// Profiles often share images, so gather the unique paths first
+	std::vector<std::string> imagePaths;
+	std::unordered_map<std::string, uint> imageIndex;
+	std::vector<std::vector<uint> > profileImages(config.profiles.size());
+	forloop(profileIndex, config.profiles.size())
+	{
+		const Config& profile = config.profiles[profileIndex];
+		forloop(i, profile.imagePaths.size())
+		{
+			std::pair<std::unordered_map<std::string, uint>::iterator, bool> inserted =
+				imageIndex.insert(std::make_pair(profile.imagePaths[i], (uint)imagePaths.size()));
+			if (inserted.second) imagePaths.push_back(profile.imagePaths[i]);
+			profileImages[profileIndex].push_back(inserted.first->second);
+		}
+	}
+
+	struct BakedImage
+	{
+		std::vector<unsigned char> file;
+		uint64 contentHash;
+		Image image;
+		// Index of the first image with the same contents, which owns the pixels
+		uint pixelsOwner;
+		// Why the image couldn't be baked, or 0
+		const char* error;
+	};
+	std::vector<BakedImage> images(imagePaths.size());
+	forloop(i, images.size())
+	{
+		BakedImage* baked = &images[i];
+		const char* path = imagePaths[i].c_str();
+		addJob(jobs, [baked, path]{
+			baked->image = Image();
+			baked->error = 0;
+			if (!readEntireFile(path, &baked->file)) {
+				baked->error = "couldn't read file";
+				return;
+			}
+			baked->contentHash = hashBytes(baked->file.data(), baked->file.size());
+			if (!loadImageFromMemory(&baked->image, baked->file.data(), baked->file.size())) {
+				baked->error = "couldn't decode image";
+			}
+		});
+	}
+	waitForJobs(jobs);
+
+	// A bundle is meant to be handed out on its own, so one with a missing image isn't written at all
+	bool imagesLoaded = true;
+	forloop(i, images.size())
+	{
+		if (images[i].error) {
+			fprintf(stderr, "%s: %s\n", imagePaths[i].c_str(), images[i].error);
+			imagesLoaded = false;
+		}
+	}
+	if (!imagesLoaded) {
+		forloop(i, images.size())
+		{
+			if (images[i].image.pixels) freeImage(&images[i].image);
+		}
+		return false;
+	}
+
+	BundleHeader header ={0};
+	header.magic = BundleHeader::expectedMagic;
+	header.version = BundleHeader::expectedVersion;
+	header.inputMappingSize = sizeof(InputMapping);
+	header.directionMappingSize = sizeof(DirectionMapping);
+	header.motionMatchSize = sizeof(MotionMatch);
+	header.profileCount = config.profiles.size();
+	header.imageCount = images.size();
+
+	// Lay out the file
+	uint64 offset = sizeof(BundleHeader);
+	header.profilesOffset = offset;
+	offset += sizeof(BundleProfile)*config.profiles.size();
+	std::vector<BundleProfile> bundleProfiles(config.profiles.size());
+	forloop(profileIndex, config.profiles.size())
+	{
+		const Config& profile = config.profiles[profileIndex];
+		BundleProfile* bundleProfile = &bundleProfiles[profileIndex];
+		bundleProfile->backgroundColor = profile.backgroundColor;
+		bundleProfile->alwaysOnTop = profile.alwaysOnTop;
+		bundleProfile->transparentBackground = profile.transparentBackground;
+		bundleProfile->imageWidth = profile.imageWidth;
+		bundleProfile->imageHeight = profile.imageHeight;
+		bundleProfile->maxDisplayedInputs = profile.maxDisplayedInputs;
+		bundleProfile->hotkey = profile.hotkey;
+		bundleProfile->inputMapCount = profile.inputMaps.size();
+		bundleProfile->directionMapCount = profile.directionMaps.size();
+		bundleProfile->imageCount = profile.imagePaths.size();
+		bundleProfile->nameOffset = offset;
+		offset += profile.name.size()+1;
+		bundleProfile->joystickCount = profile.joysticks.size();
+		bundleProfile->joysticksOffset = offset;
+		forloop(i, profile.joysticks.size())
+		{
+			offset += profile.joysticks[i].size()+1;
+		}
+		offset = alignOffset(offset, 8);
+		bundleProfile->inputMapsOffset = offset;
+		offset += sizeof(InputMapping)*profile.inputMaps.size();
+		bundleProfile->directionMapsOffset = offset;
+		offset += sizeof(DirectionMapping)*profile.directionMaps.size();
+		bundleProfile->imageIndicesOffset = offset;
+		offset += sizeof(uint)*profile.imagePaths.size();
+		const MotionRecognizer& motions = profile.motionRecognizer;
+		bundleProfile->motionStateCount = motions.matchStarts.size()-1;
+		bundleProfile->motionMatchCount = motions.matches.size();
+		bundleProfile->motionTransitionsOffset = offset;
+		offset += sizeof(uint)*motions.transitions.size();
+		bundleProfile->motionMatchStartsOffset = offset;
+		offset += sizeof(uint)*motions.matchStarts.size();
+		bundleProfile->motionMatchesOffset = offset;
+		offset += sizeof(MotionMatch)*motions.matches.size();
+	}
+	offset = alignOffset(offset, 8);
+	header.imagesOffset = offset;
+	offset += sizeof(BundleImage)*images.size();
+	std::vector<BundleImage> bundleImages(images.size());
+	forloop(i, images.size())
+	{
+		bundleImages[i].pathOffset = offset;
+		offset += imagePaths[i].size()+1;
+	}
+	std::unordered_map<uint64, uint> firstWithHash;
+	forloop(i, images.size())
+	{
+		BundleImage* bundleImage = &bundleImages[i];
+		bundleImage->contentHash = images[i].contentHash;
+		bundleImage->width = images[i].image.width;
+		bundleImage->height = images[i].image.height;
+		images[i].pixelsOwner = firstWithHash.insert(std::make_pair(images[i].contentHash, i)).first->second;
+		if (images[i].pixelsOwner == i) {
+			offset = alignOffset(offset, 16);
+			bundleImage->pixelsOffset = offset;
+			offset += (uint64)bundleImage->width*bundleImage->height*4;
+		}
+		else {
+			bundleImage->pixelsOffset = bundleImages[images[i].pixelsOwner].pixelsOffset;
+		}
+	}
+	header.fileSize = offset;
+
+	// Write it, padding up to each aligned offset
+	std::string temporaryPath = std::string(bundlePath) + ".tmp";
+	FILE* file = fopen(temporaryPath.c_str(), "wb");
+	if (!file) return false;
+	const char padding[16] ={0};
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(bundleProfiles.data(), sizeof(BundleProfile), bundleProfiles.size(), file);
+	forloop(profileIndex, config.profiles.size())
+	{
+		const Config& profile = config.profiles[profileIndex];
+		fwrite(profile.name.c_str(), 1, profile.name.size()+1, file);
+		forloop(i, profile.joysticks.size())
+		{
+			fwrite(profile.joysticks[i].c_str(), 1, profile.joysticks[i].size()+1, file);
+		}
+		fwrite(padding, 1, bundleProfiles[profileIndex].inputMapsOffset - ftell(file), file);
+		fwrite(profile.inputMaps.data(), sizeof(InputMapping), profile.inputMaps.size(), file);
+		fwrite(profile.directionMaps.data(), sizeof(DirectionMapping), profile.directionMaps.size(), file);
+		fwrite(profileImages[profileIndex].data(), sizeof(uint), profileImages[profileIndex].size(), file);
+		const MotionRecognizer& motions = profile.motionRecognizer;
+		fwrite(motions.transitions.data(), sizeof(uint), motions.transitions.size(), file);
+		fwrite(motions.matchStarts.data(), sizeof(uint), motions.matchStarts.size(), file);
+		fwrite(motions.matches.data(), sizeof(MotionMatch), motions.matches.size(), file);
+	}
+	fwrite(padding, 1, header.imagesOffset - ftell(file), file);
+	fwrite(bundleImages.data(), sizeof(BundleImage), bundleImages.size(), file);
+	forloop(i, images.size())
+	{
+		fwrite(imagePaths[i].c_str(), 1, imagePaths[i].size()+1, file);
+	}
+	forloop(i, images.size())
+	{
+		if (images[i].pixelsOwner == i) {
+			fwrite(padding, 1, bundleImages[i].pixelsOffset - ftell(file), file);
+			fwrite(images[i].image.pixels, 1, (size_t)bundleImages[i].width*bundleImages[i].height*4, file);
+		}
+		if (images[i].image.pixels) {
+			freeImage(&images[i].image);
+		}
+	}
+	bool written = !ferror(file) && (uint64)ftell(file) == header.fileSize;
+	fclose(file);
+	if (!written || !replaceFile(temporaryPath.c_str(), bundlePath)) {
+		remove(temporaryPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+// Whether count elements of elementSize bytes starting at offset fit in the file, without overflowing
+bool bundleRangeValid(const MappedFile& file, uint64 offset, uint64 count, uint64 elementSize)
+{
+	return offset <= file.size && count <= (file.size - offset) / elementSize;
+}
+
+// Whether there's a null terminated string at offset, returning the offset just past it
+bool bundleStringValid(const MappedFile& file, uint64 offset, uint64* out_end)
+{
+	if (offset >= file.size) return false;
+	const void* terminator = memchr(file.data + offset, 0, file.size - offset);
+	if (!terminator) return false;
+	*out_end = (const unsigned char*)terminator - file.data + 1;
+	return true;
+}
+
+// Check every offset, length and index in a bundle before any of it is used, so a damaged or cut short
+// file can't make loading read past the mapping or leave indices pointing outside their arrays
+bool bundleContentsValid(const MappedFile& file, const BundleHeader& header)
+{
+	if (!bundleRangeValid(file, header.profilesOffset, header.profileCount, sizeof(BundleProfile))
+		|| !bundleRangeValid(file, header.imagesOffset, header.imageCount, sizeof(BundleImage)))
+	{
+		return false;
+	}
+	uint64 end;
+	const BundleImage* bundleImages = (const BundleImage*)(file.data + header.imagesOffset);
+	forloop(i, header.imageCount)
+	{
+		const BundleImage& image = bundleImages[i];
+		if (!bundleStringValid(file, image.pathOffset, &end)) return false;
+		if (image.width && !bundleRangeValid(file, image.pixelsOffset, (uint64)image.width*image.height, 4)) return false;
+	}
+	const BundleProfile* bundleProfiles = (const BundleProfile*)(file.data + header.profilesOffset);
+	forloop(profileIndex, header.profileCount)
+	{
+		const BundleProfile& profile = bundleProfiles[profileIndex];
+		if (!bundleStringValid(file, profile.nameOffset, &end)) return false;
+		end = profile.joysticksOffset;
+		forloop(i, profile.joystickCount)
+		{
+			if (!bundleStringValid(file, end, &end)) return false;
+		}
+		uint stateCount = profile.motionStateCount;
+		if (stateCount == 0
+			|| !bundleRangeValid(file, profile.inputMapsOffset, profile.inputMapCount, sizeof(InputMapping))
+			|| !bundleRangeValid(file, profile.directionMapsOffset, profile.directionMapCount, sizeof(DirectionMapping))
+			|| !bundleRangeValid(file, profile.imageIndicesOffset, profile.imageCount, sizeof(uint))
+			|| !bundleRangeValid(file, profile.motionTransitionsOffset, (uint64)stateCount*MotionRecognizer::symbolCount, sizeof(uint))
+			|| !bundleRangeValid(file, profile.motionMatchStartsOffset, (uint64)stateCount+1, sizeof(uint))
+			|| !bundleRangeValid(file, profile.motionMatchesOffset, profile.motionMatchCount, sizeof(MotionMatch)))
+		{
+			return false;
+		}
+
+		// Images are looked up through these indices as the program runs
+		const uint* imageIndices = (const uint*)(file.data + profile.imageIndicesOffset);
+		forloop(i, profile.imageCount)
+		{
+			if (imageIndices[i] >= header.imageCount) return false;
+		}
+		const InputMapping* inputMaps = (const InputMapping*)(file.data + profile.inputMapsOffset);
+		forloop(i, profile.inputMapCount)
+		{
+			if (inputMaps[i].result.type == InputResult::Type_image && inputMaps[i].result.image >= profile.imageCount) return false;
+		}
+		const DirectionMapping* directionMaps = (const DirectionMapping*)(file.data + profile.directionMapsOffset);
+		forloop(i, profile.directionMapCount)
+		{
+			if (directionMaps[i].image >= profile.imageCount) return false;
+		}
+		const uint* transitions = (const uint*)(file.data + profile.motionTransitionsOffset);
+		forloop(i, stateCount*MotionRecognizer::symbolCount)
+		{
+			if (transitions[i] >= stateCount) return false;
+		}
+		const uint* matchStarts = (const uint*)(file.data + profile.motionMatchStartsOffset);
+		forloop(state, stateCount)
+		{
+			if (matchStarts[state] > matchStarts[state+1]) return false;
+		}
+		if (matchStarts[0] != 0 || matchStarts[stateCount] != profile.motionMatchCount) return false;
+		const MotionMatch* matches = (const MotionMatch*)(file.data + profile.motionMatchesOffset);
+		forloop(i, profile.motionMatchCount)
+		{
+			if (matches[i].image >= profile.imageCount || matches[i].span == 0 || matches[i].span > MotionRecognizer::maxSteps) return false;
+		}
+	}
+	return true;
+}
+
+// Load a baked bundle, uploading its pixels straight from the mapped file.
+// Returns false with a message in error if the bundle can't be used, without changing out or textures.
+bool loadBundle(ConfigSet* out, TextureCache* textures, const char* bundlePath, std::string* error)
+{
+	MappedFile file;
+	if (!mapFile(&file, bundlePath)) {
+		*error = "couldn't open file";
+		return false;
+	}
+	BundleHeader header;
+	bool valid = file.size >= sizeof(BundleHeader);
+	if (valid) {
+		memcpy(&header, file.data, sizeof(BundleHeader));
+		valid = header.magic == BundleHeader::expectedMagic;
+	}
+	if (!valid) {
+		*error = "not a bundle";
+	}
+	else if (header.version != BundleHeader::expectedVersion
+		|| header.inputMappingSize != sizeof(InputMapping)
+		|| header.directionMappingSize != sizeof(DirectionMapping)
+		|| header.motionMatchSize != sizeof(MotionMatch))
+	{
+		*error = "bundle was baked by a different build; re-bake it";
+		valid = false;
+	}
+	else if (header.fileSize != file.size || !bundleContentsValid(file, header)) {
+		*error = "bundle is damaged or cut short; re-bake it";
+		valid = false;
+	}
+	if (!valid) {
+		unmapFile(&file);
+		return false;
+	}
+
+	const BundleProfile* bundleProfiles = (const BundleProfile*)(file.data + header.profilesOffset);
+	const BundleImage* bundleImages = (const BundleImage*)(file.data + header.imagesOffset);
+	out->profiles.resize(header.profileCount);
+	forloop(profileIndex, header.profileCount)
+	{
+		const BundleProfile& bundleProfile = bundleProfiles[profileIndex];
+		Config* profile = &out->profiles[profileIndex];
+		profile->name = (const char*)(file.data + bundleProfile.nameOffset);
+		const char* joystick = (const char*)(file.data + bundleProfile.joysticksOffset);
+		profile->joysticks.resize(bundleProfile.joystickCount);
+		forloop(i, bundleProfile.joystickCount)
+		{
+			profile->joysticks[i] = joystick;
+			joystick += profile->joysticks[i].size()+1;
+		}
+		profile->backgroundColor = bundleProfile.backgroundColor;
+		profile->alwaysOnTop = bundleProfile.alwaysOnTop != 0;
+		profile->transparentBackground = bundleProfile.transparentBackground != 0;
+		profile->imageWidth = bundleProfile.imageWidth;
+		profile->imageHeight = bundleProfile.imageHeight;
+		profile->maxDisplayedInputs = bundleProfile.maxDisplayedInputs;
+		profile->hotkey = bundleProfile.hotkey;
+		const InputMapping* inputMaps = (const InputMapping*)(file.data + bundleProfile.inputMapsOffset);
+		profile->inputMaps.assign(inputMaps, inputMaps + bundleProfile.inputMapCount);
+		const DirectionMapping* directionMaps = (const DirectionMapping*)(file.data + bundleProfile.directionMapsOffset);
+		profile->directionMaps.assign(directionMaps, directionMaps + bundleProfile.directionMapCount);
+		MotionRecognizer* motions = &profile->motionRecognizer;
+		const uint* transitions = (const uint*)(file.data + bundleProfile.motionTransitionsOffset);
+		motions->transitions.assign(transitions, transitions + (size_t)bundleProfile.motionStateCount*MotionRecognizer::symbolCount);
+		const uint* matchStarts = (const uint*)(file.data + bundleProfile.motionMatchStartsOffset);
+		motions->matchStarts.assign(matchStarts, matchStarts + bundleProfile.motionStateCount+1);
+		const MotionMatch* matches = (const MotionMatch*)(file.data + bundleProfile.motionMatchesOffset);
+		motions->matches.assign(matches, matches + bundleProfile.motionMatchCount);
+
+		const uint* imageIndices = (const uint*)(file.data + bundleProfile.imageIndicesOffset);
+		profile->imagePaths.resize(bundleProfile.imageCount);
+		profile->images.resize(bundleProfile.imageCount);
+		forloop(i, bundleProfile.imageCount)
+		{
+			const BundleImage& bundleImage = bundleImages[imageIndices[i]];
+			profile->imagePaths[i] = (const char*)(file.data + bundleImage.pathOffset);
+			Image image;
+			image.pixels = bundleImage.width ? (unsigned char*)file.data + bundleImage.pixelsOffset : 0;
+			image.width = bundleImage.width;
+			image.height = bundleImage.height;
+			profile->images[i] = acquireDecodedTexture(textures, profile->imagePaths[i], bundleImage.contentHash, image);
+		}
+	}
+	unmapFile(&file);
+	return true;
+}
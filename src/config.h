@@ -0,0 +1,794 @@
+struct ButtonInputAction
+{
+	uint buttonIndex;
+};
+
+// D-pads are sometimes mapped to 8-way HAT inputs
+struct HatInputAction
+{
+	uint pov;
+};
+
+struct AxisInputAction
+{
+	uint axisIndex;
+	float restPosition;
+	float triggerPosition;
+};
+
+struct KeyboardInputAction
+{
+	uint keyIndex;
+};
+
+struct InputAction
+{
+	enum Type { Type_button, Type_hat, Type_axis, Type_keyboard };
+
+	union {
+		ButtonInputAction button;
+		HatInputAction hat;
+		AxisInputAction axis;
+		KeyboardInputAction key;
+	};
+
+	Type type;
+};
+
+struct InputResult
+{
+	enum Type { Type_direction, Type_image };
+	union {
+		// Index into Config::images
+		uint image;
+		uint direction;
+	};
+	Type type;
+};
+
+struct InputMapping
+{
+	InputResult result;
+	InputAction input;
+};
+
+struct DirectionMapping
+{
+	uint direction;
+	uint image;
+};
+
+struct Config
+{
+	std::string name;
+	Color backgroundColor;
+	bool alwaysOnTop;
+	bool transparentBackground;
+	uint imageWidth;
+	uint imageHeight;
+	uint maxDisplayedInputs;
+	std::vector<InputMapping> inputMaps;
+	std::vector<DirectionMapping> directionMaps;
+	// Motions as written, and the automaton that recognizes them all. Bundles only keep the automaton.
+	std::vector<MotionPattern> motions;
+	MotionRecognizer motionRecognizer;
+	// Images are collected while parsing and loaded all at once afterwards.
+	// images holds the TextureCache id for each path.
+	std::vector<std::string> imagePaths;
+	std::vector<uint> images;
+	// GUIDs or names of the joysticks that use this profile's mappings instead of the active profile's
+	std::vector<std::string> joysticks;
+	// Key that switches to this profile, or 0 for none
+	uint hotkey;
+};
+
+// Every profile in a config file. Each profile is a complete config, and the program shows one at a time.
+// Profiles that use the same image files share their textures through the TextureCache.
+struct ConfigSet
+{
+	std::vector<Config> profiles;
+};
+
+// A piece of the config text. Points into the file's buffer rather than copying.
+struct StringView
+{
+	const char* data;
+	uint length;
+};
+
+bool operator==(StringView view, const char* text)
+{
+	return strncmp(view.data, text, view.length) == 0 && text[view.length] == 0;
+}
+
+struct ConfigError
+{
+	uint line;
+	uint column;
+	std::string message;
+};
+
+// Reads the config one line at a time, splitting lines into whitespace separated tokens
+struct ConfigParser
+{
+	const char* cursor;
+	const char* end;
+	const char* lineStart;
+	uint line;
+	// Start of the last token read, for error positions
+	const char* tokenStart;
+	std::vector<ConfigError>* errors;
+	// In the key = value format, = is a token of its own and # starts a comment
+	bool keyValue;
+};
+
+void addConfigError(ConfigParser* parser, const char* position, const std::string& message)
+{
+	ConfigError error;
+	error.line = parser->line;
+	error.column = uint(position - parser->lineStart) + 1;
+	error.message = message;
+	parser->errors->push_back(error);
+}
+
+bool atLineEnd(ConfigParser* parser)
+{
+	while (parser->cursor < parser->end && (*parser->cursor == ' ' || *parser->cursor == '\t' || *parser->cursor == '\r')) {
+		++parser->cursor;
+	}
+	return parser->cursor == parser->end || *parser->cursor == '\n' || (parser->keyValue && *parser->cursor == '#');
+}
+
+// Read the next token on the current line. Fails at the end of the line, reporting an error saying what was expected.
+bool nextToken(ConfigParser* parser, StringView* out, const char* expected)
+{
+	if (atLineEnd(parser)) {
+		if (expected) addConfigError(parser, parser->cursor, std::string("expected ") + expected);
+		return false;
+	}
+	const char* start = parser->cursor;
+	if (parser->keyValue && *parser->cursor == '=') {
+		++parser->cursor;
+	}
+	else {
+		while (parser->cursor < parser->end && *parser->cursor != ' ' && *parser->cursor != '\t' && *parser->cursor != '\r' && *parser->cursor != '\n'
+			&& !(parser->keyValue && (*parser->cursor == '=' || *parser->cursor == '#')))
+		{
+			++parser->cursor;
+		}
+	}
+	out->data = start;
+	out->length = uint(parser->cursor - start);
+	parser->tokenStart = start;
+	return true;
+}
+
+// The rest of the line up to any comment, without surrounding spaces. For values that can have spaces in them.
+bool restOfLine(ConfigParser* parser, StringView* out, const char* expected)
+{
+	if (atLineEnd(parser)) {
+		addConfigError(parser, parser->cursor, std::string("expected ") + expected);
+		return false;
+	}
+	const char* start = parser->cursor;
+	const char* end = start;
+	while (parser->cursor < parser->end && *parser->cursor != '\n' && !(parser->keyValue && *parser->cursor == '#')) {
+		if (*parser->cursor != ' ' && *parser->cursor != '\t' && *parser->cursor != '\r') end = parser->cursor+1;
+		++parser->cursor;
+	}
+	out->data = start;
+	out->length = uint(end - start);
+	parser->tokenStart = start;
+	return true;
+}
+
+// Skip the rest of the current line, which is treated as a comment, and move to the next one
+bool nextLine(ConfigParser* parser)
+{
+	while (parser->cursor < parser->end && *parser->cursor != '\n') {
+		++parser->cursor;
+	}
+	if (parser->cursor == parser->end) return false;
+	++parser->cursor;
+	parser->lineStart = parser->cursor;
+	++parser->line;
+	return true;
+}
+
+bool parseUIntToken(ConfigParser* parser, StringView token, uint* out)
+{
+	uint result = 0;
+	forloop(i, token.length)
+	{
+		char c = token.data[i];
+		if (c < '0' || c > '9' || result > (0xFFFFFFFFu - (c-'0')) / 10) {
+			addConfigError(parser, token.data, "expected a whole number");
+			return false;
+		}
+		result = result*10 + (c-'0');
+	}
+	*out = result;
+	return true;
+}
+
+bool parseFloatToken(ConfigParser* parser, StringView token, float* out)
+{
+	uint i = 0;
+	float sign = 1;
+	if (i < token.length && (token.data[i] == '-' || token.data[i] == '+')) {
+		if (token.data[i] == '-') sign = -1;
+		++i;
+	}
+	float result = 0;
+	bool haveDigits = false;
+	for (; i < token.length && token.data[i] >= '0' && token.data[i] <= '9'; ++i) {
+		result = result*10 + (token.data[i]-'0');
+		haveDigits = true;
+	}
+	if (i < token.length && token.data[i] == '.') {
+		++i;
+		float scale = 0.1f;
+		for (; i < token.length && token.data[i] >= '0' && token.data[i] <= '9'; ++i) {
+			result += (token.data[i]-'0')*scale;
+			scale *= 0.1f;
+			haveDigits = true;
+		}
+	}
+	if (!haveDigits || i != token.length) {
+		addConfigError(parser, token.data, "expected a number");
+		return false;
+	}
+	*out = sign*result;
+	return true;
+}
+
+bool parseBoolToken(ConfigParser* parser, StringView token, bool* out)
+{
+	if (token == "true") *out = true;
+	else if (token == "false") *out = false;
+	else {
+		addConfigError(parser, token.data, "expected true or false");
+		return false;
+	}
+	return true;
+}
+
+// Cardinal directions, which buttons, hats and axes can map to
+bool parseCardinalDirection(StringView token, uint* out)
+{
+	if      (token == "left")  *out = SDL_HAT_LEFT;
+	else if (token == "right") *out = SDL_HAT_RIGHT;
+	else if (token == "up")    *out = SDL_HAT_UP;
+	else if (token == "down")  *out = SDL_HAT_DOWN;
+	else return false;
+	return true;
+}
+
+bool parseDirection(StringView token, uint* out)
+{
+	if (parseCardinalDirection(token, out)) return true;
+	else if (token == "upleft")    *out = SDL_HAT_LEFTUP;
+	else if (token == "downleft")  *out = SDL_HAT_LEFTDOWN;
+	else if (token == "upright")   *out = SDL_HAT_RIGHTUP;
+	else if (token == "downright") *out = SDL_HAT_RIGHTDOWN;
+	else if (token == "center")    *out = SDL_HAT_CENTERED;
+	else return false;
+	return true;
+}
+
+uint addImagePath(Config* mod, StringView path)
+{
+	mod->imagePaths.push_back(std::string(path.data, path.length));
+	return mod->imagePaths.size()-1;
+}
+
+bool parseInputResult(Config* config, ConfigParser* parser, InputResult* out)
+{
+	StringView token;
+	if (!nextToken(parser, &token, "a direction or image file")) return false;
+	if (parseCardinalDirection(token, &out->direction)) {
+		out->type = InputResult::Type_direction;
+	}
+	else {
+		out->type = InputResult::Type_image;
+		out->image = addImagePath(config, token);
+	}
+	return true;
+}
+
+bool parseDirectionMapping(Config* config, ConfigParser* parser, DirectionMapping* out)
+{
+	StringView token;
+	if (!nextToken(parser, &token, "a direction")) return false;
+	if (!parseDirection(token, &out->direction)) {
+		addConfigError(parser, token.data, "unknown direction");
+		return false;
+	}
+	if (!nextToken(parser, &token, "an image file")) return false;
+	out->image = addImagePath(config, token);
+	return true;
+}
+
+bool parseButtonAction(ConfigParser* parser, InputAction* out)
+{
+	StringView token;
+	out->type = InputAction::Type_button;
+	return nextToken(parser, &token, "a button index")
+		&& parseUIntToken(parser, token, &out->button.buttonIndex);
+}
+
+bool parseHatAction(ConfigParser* parser, InputAction* out)
+{
+	StringView token;
+	out->type = InputAction::Type_hat;
+	if (!nextToken(parser, &token, "a hat direction")) return false;
+	if (!parseCardinalDirection(token, &out->hat.pov)) {
+		addConfigError(parser, token.data, "expected left, right, up or down");
+		return false;
+	}
+	return true;
+}
+
+bool parseAxisAction(ConfigParser* parser, InputAction* out)
+{
+	StringView token;
+	out->type = InputAction::Type_axis;
+	return nextToken(parser, &token, "an axis index")
+		&& parseUIntToken(parser, token, &out->axis.axisIndex)
+		&& nextToken(parser, &token, "the axis rest position")
+		&& parseFloatToken(parser, token, &out->axis.restPosition)
+		&& nextToken(parser, &token, "the axis trigger position")
+		&& parseFloatToken(parser, token, &out->axis.triggerPosition);
+}
+
+// The original format, where the first six lines are settings in a fixed order and every other line is a mapping.
+// Anything after the values a line needs is a comment.
+void parsePositionalConfig(Config* out, ConfigParser* parser)
+{
+	StringView token;
+	// The first six lines are settings, in this order
+	bool haveLine = true;
+	if (nextToken(parser, &token, "always on top setting")) parseBoolToken(parser, token, &out->alwaysOnTop);
+	haveLine = haveLine && nextLine(parser);
+	if (haveLine && nextToken(parser, &token, "transparent background setting")) parseBoolToken(parser, token, &out->transparentBackground);
+	haveLine = haveLine && nextLine(parser);
+	if (haveLine
+		&& nextToken(parser, &token, "background color red") && parseFloatToken(parser, token, &out->backgroundColor.r)
+		&& nextToken(parser, &token, "background color green") && parseFloatToken(parser, token, &out->backgroundColor.g)
+		&& nextToken(parser, &token, "background color blue"))
+	{
+		parseFloatToken(parser, token, &out->backgroundColor.b);
+	}
+	haveLine = haveLine && nextLine(parser);
+	if (haveLine && nextToken(parser, &token, "image width")) parseUIntToken(parser, token, &out->imageWidth);
+	haveLine = haveLine && nextLine(parser);
+	if (haveLine && nextToken(parser, &token, "image height")) parseUIntToken(parser, token, &out->imageHeight);
+	haveLine = haveLine && nextLine(parser);
+	if (haveLine && nextToken(parser, &token, "maximum displayed inputs")) parseUIntToken(parser, token, &out->maxDisplayedInputs);
+	if (!haveLine) {
+		addConfigError(parser, parser->cursor, "config ends before all settings are given");
+		return;
+	}
+
+	// Direction and input mappings
+	while (nextLine(parser)) {
+		if (!nextToken(parser, &token, 0)) continue;
+		InputMapping inputMap ={0};
+		DirectionMapping directionMap ={0};
+		if (token == "d") {
+			if (parseDirectionMapping(out, parser, &directionMap)) out->directionMaps.push_back(directionMap);
+		}
+		else if (token == "b") {
+			if (parseButtonAction(parser, &inputMap.input) && parseInputResult(out, parser, &inputMap.result)) out->inputMaps.push_back(inputMap);
+		}
+		else if (token == "h") {
+			if (parseHatAction(parser, &inputMap.input) && parseInputResult(out, parser, &inputMap.result)) out->inputMaps.push_back(inputMap);
+		}
+		else if (token == "a") {
+			if (parseAxisAction(parser, &inputMap.input) && parseInputResult(out, parser, &inputMap.result)) out->inputMaps.push_back(inputMap);
+		}
+		else {
+			addConfigError(parser, token.data, "unknown mapping type, expected d, b, h or a");
+		}
+	}
+}
+
+// Letters, digits and F1 to F12, as key codes for WindowMessages
+bool parseKeyName(StringView token, uint* out)
+{
+	if (token.length == 1) {
+		char c = token.data[0];
+		if (c >= 'a' && c <= 'z') c += 'A' - 'a';
+		if ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+			*out = (uint)c;
+			return true;
+		}
+		return false;
+	}
+	if ((token.data[0] == 'F' || token.data[0] == 'f') && token.length <= 3) {
+		uint number = 0;
+		for (uint i=1; i<token.length; ++i) {
+			if (token.data[i] < '0' || token.data[i] > '9') return false;
+			number = number*10 + (token.data[i] - '0');
+		}
+		if (number >= 1 && number <= 12) {
+			*out = keyF1 + number-1;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool expectEquals(ConfigParser* parser)
+{
+	StringView token;
+	if (!nextToken(parser, &token, "=")) return false;
+	if (!(token == "=")) {
+		addConfigError(parser, token.data, "expected =");
+		return false;
+	}
+	return true;
+}
+
+bool expectLineEnd(ConfigParser* parser)
+{
+	if (!atLineEnd(parser)) {
+		addConfigError(parser, parser->cursor, "unexpected text after the value");
+		return false;
+	}
+	return true;
+}
+
+// A motion's steps, each a direction or a button, with its window and leniency anywhere among them:
+// motion down downright right button 0 within 12 leniency 1 = image
+// Directions can also be numeric keypad digits, so 2 3 6 is the same as down downright right.
+void parseMotionLine(Config* profile, ConfigParser* parser)
+{
+	StringView token;
+	MotionPattern motion;
+	motion.window = 15;
+	motion.leniency = 0;
+	bool haveEquals = false;
+	while (!haveEquals && nextToken(parser, &token, "= and an image file after the motion's steps")) {
+		uint value;
+		if (token == "=") {
+			haveEquals = true;
+		}
+		else if (token == "button") {
+			if (!(nextToken(parser, &token, "a button index") && parseUIntToken(parser, token, &value))) return;
+			if (value >= Input::Joystick::State::buttonCount) {
+				addConfigError(parser, token.data, "button index is too high");
+				return;
+			}
+			motion.steps.push_back(getButtonSymbol(value));
+		}
+		else if (token == "within") {
+			if (!(nextToken(parser, &token, "a number of frames") && parseUIntToken(parser, token, &motion.window))) return;
+		}
+		else if (token == "leniency") {
+			if (!(nextToken(parser, &token, "a number of steps") && parseUIntToken(parser, token, &motion.leniency))) return;
+			if (motion.leniency > MotionRecognizer::maxLeniency) {
+				char message[64];
+				snprintf(message, sizeof(message), "leniency can be at most %u", MotionRecognizer::maxLeniency);
+				addConfigError(parser, token.data, message);
+				return;
+			}
+		}
+		else if (parseDirection(token, &value)) {
+			motion.steps.push_back(getDirectionSymbol(value));
+		}
+		else if (token.length == 1 && token.data[0] >= '1' && token.data[0] <= '9') {
+			motion.steps.push_back(token.data[0] - '1');
+		}
+		else {
+			addConfigError(parser, token.data, "expected a direction, button, within or leniency");
+			return;
+		}
+	}
+	if (!haveEquals) return;
+	if (motion.steps.empty() || motion.steps.size() > MotionRecognizer::maxSteps) {
+		char message[64];
+		snprintf(message, sizeof(message), "a motion needs from 1 to %u steps", MotionRecognizer::maxSteps);
+		addConfigError(parser, token.data, message);
+		return;
+	}
+	if (nextToken(parser, &token, "an image file") && expectLineEnd(parser)) {
+		motion.image = addImagePath(profile, token);
+		profile->motions.push_back(motion);
+	}
+}
+
+// One line of the key = value format, applied to the profile being parsed
+void parseKeyValueLine(Config* profile, ConfigParser* parser, StringView key)
+{
+	StringView token;
+	InputMapping inputMap ={0};
+	DirectionMapping directionMap ={0};
+	if (key == "direction") {
+		if (!nextToken(parser, &token, "a direction")) return;
+		if (!parseDirection(token, &directionMap.direction)) {
+			addConfigError(parser, token.data, "unknown direction");
+			return;
+		}
+		if (expectEquals(parser) && nextToken(parser, &token, "an image file") && expectLineEnd(parser)) {
+			directionMap.image = addImagePath(profile, token);
+			profile->directionMaps.push_back(directionMap);
+		}
+	}
+	else if (key == "button" || key == "hat" || key == "axis") {
+		bool haveAction = (key == "button" && parseButtonAction(parser, &inputMap.input))
+			|| (key == "hat" && parseHatAction(parser, &inputMap.input))
+			|| (key == "axis" && parseAxisAction(parser, &inputMap.input));
+		if (haveAction && expectEquals(parser) && parseInputResult(profile, parser, &inputMap.result) && expectLineEnd(parser)) {
+			profile->inputMaps.push_back(inputMap);
+		}
+	}
+	else if (key == "motion") {
+		parseMotionLine(profile, parser);
+	}
+	else if (key == "alwaysOnTop") {
+		if (expectEquals(parser) && nextToken(parser, &token, "true or false")) parseBoolToken(parser, token, &profile->alwaysOnTop);
+		expectLineEnd(parser);
+	}
+	else if (key == "transparentBackground") {
+		if (expectEquals(parser) && nextToken(parser, &token, "true or false")) parseBoolToken(parser, token, &profile->transparentBackground);
+		expectLineEnd(parser);
+	}
+	else if (key == "backgroundColor") {
+		Color color;
+		if (expectEquals(parser)
+			&& nextToken(parser, &token, "red") && parseFloatToken(parser, token, &color.r)
+			&& nextToken(parser, &token, "green") && parseFloatToken(parser, token, &color.g)
+			&& nextToken(parser, &token, "blue") && parseFloatToken(parser, token, &color.b))
+		{
+			profile->backgroundColor = color;
+		}
+		expectLineEnd(parser);
+	}
+	else if (key == "imageWidth") {
+		if (expectEquals(parser) && nextToken(parser, &token, "a width in pixels")) parseUIntToken(parser, token, &profile->imageWidth);
+		expectLineEnd(parser);
+	}
+	else if (key == "imageHeight") {
+		if (expectEquals(parser) && nextToken(parser, &token, "a height in pixels")) parseUIntToken(parser, token, &profile->imageHeight);
+		expectLineEnd(parser);
+	}
+	else if (key == "maxDisplayedInputs") {
+		if (expectEquals(parser) && nextToken(parser, &token, "a number of inputs")) parseUIntToken(parser, token, &profile->maxDisplayedInputs);
+		expectLineEnd(parser);
+	}
+	else if (key == "hotkey") {
+		if (expectEquals(parser) && nextToken(parser, &token, "a key") && !parseKeyName(token, &profile->hotkey)) {
+			addConfigError(parser, token.data, "expected a letter, a digit or F1 to F12");
+		}
+		expectLineEnd(parser);
+	}
+	else if (key == "joystick") {
+		if (expectEquals(parser) && restOfLine(parser, &token, "a joystick GUID or name")) {
+			profile->joysticks.push_back(std::string(token.data, token.length));
+		}
+	}
+	else {
+		addConfigError(parser, key.data, "unknown setting");
+	}
+}
+
+// The key = value format, with any number of [profile] sections.
+// Settings and mappings before the first section are shared, and each profile starts as a copy of them.
+// Without any sections, the shared part is the only profile.
+void parseKeyValueConfig(ConfigSet* out, ConfigParser* parser)
+{
+	Config shared;
+	shared.name = "default";
+	shared.backgroundColor.r = shared.backgroundColor.g = shared.backgroundColor.b = 0;
+	shared.alwaysOnTop = false;
+	shared.transparentBackground = false;
+	shared.imageWidth = 48;
+	shared.imageHeight = 48;
+	shared.maxDisplayedInputs = 100;
+	shared.hotkey = 0;
+	Config* profile = &shared;
+
+	do {
+		StringView token;
+		if (!nextToken(parser, &token, 0)) continue;
+		if (token.data[0] == '[') {
+			if (token.length < 3 || token.data[token.length-1] != ']') {
+				addConfigError(parser, token.data, "expected a profile name in brackets, with no spaces");
+				continue;
+			}
+			std::string name(token.data+1, token.length-2);
+			forloop(i, out->profiles.size())
+			{
+				if (out->profiles[i].name == name) addConfigError(parser, token.data, "there's already a profile called " + name);
+			}
+			out->profiles.push_back(shared);
+			profile = &out->profiles.back();
+			profile->name = name;
+			expectLineEnd(parser);
+		}
+		else if ((token == "joystick" || token == "hotkey") && profile == &shared) {
+			addConfigError(parser, token.data, std::string(token.data, token.length) + " can only be given inside a profile");
+		}
+		else {
+			parseKeyValueLine(profile, parser, token);
+		}
+	} while (nextLine(parser));
+
+	if (out->profiles.empty()) {
+		out->profiles.push_back(shared);
+	}
+}
+
+// The key = value format is recognized by its first line being a comment, a [profile], or containing an =
+bool isKeyValueConfig(const char* text, size_t length)
+{
+	const char* end = text + length;
+	while (text < end && (*text == ' ' || *text == '\t' || *text == '\r' || *text == '\n')) ++text;
+	if (text < end && (*text == '#' || *text == '[')) return true;
+	while (text < end && *text != '\n') {
+		if (*text == '=') return true;
+		++text;
+	}
+	return false;
+}
+
+// Parse config text in a single pass, in either format.
+// Lines with errors are skipped and reported in errors, so the rest of the config still loads.
+void parseConfigText(ConfigSet* out, const char* text, size_t length, std::vector<ConfigError>* errors)
+{
+	ConfigParser parser;
+	parser.cursor = text;
+	parser.end = text + length;
+	parser.lineStart = text;
+	parser.line = 1;
+	parser.tokenStart = text;
+	parser.errors = errors;
+	parser.keyValue = isKeyValueConfig(text, length);
+	if (parser.keyValue) {
+		parseKeyValueConfig(out, &parser);
+	}
+	else {
+		Config config ={};
+		config.name = "default";
+		parsePositionalConfig(&config, &parser);
+		out->profiles.push_back(config);
+	}
+	forloop(i, out->profiles.size())
+	{
+		compileMotions(&out->profiles[i].motionRecognizer, out->profiles[i].motions);
+	}
+}
+
+// Returns false if the file couldn't be read. Parse errors are added to errors.
+bool parseConfigFile(ConfigSet* out, const char* filePath, std::vector<ConfigError>* errors)
+{
+	MappedFile file;
+	if (mapFile(&file, filePath)) {
+		parseConfigText(out, (const char*)file.data, file.size, errors);
+		unmapFile(&file);
+		return true;
+	}
+	// Empty files can't be mapped, but are still valid files
+	FileInfo info;
+	if (getFileInfo(filePath, &info) && info.size == 0) {
+		parseConfigText(out, "", 0, errors);
+		return true;
+	}
+	ConfigError error ={0};
+	error.message = "couldn't open file";
+	errors->push_back(error);
+	return false;
+}
+
+// Errors in the form "file:line:column: message", one per line
+std::string formatConfigErrors(const char* filePath, const std::vector<ConfigError>& errors)
+{
+	std::string result;
+	forloop(i, errors.size())
+	{
+		char position[32];
+		snprintf(position, sizeof(position), ":%u:%u: ", errors[i].line, errors[i].column);
+		result += filePath;
+		result += position;
+		result += errors[i].message;
+		result += "\n";
+	}
+	return result;
+}
+
+// Load every image the config's profiles use. Paths already in the cache, or used by several profiles, are only loaded once.
+// If the cache loads on request, images are only loaded once they're shown.
+void loadConfigImages(ConfigSet* mod, TextureCache* textures, JobQueue* jobs)
+{
+	forloop(profileIndex, mod->profiles.size())
+	{
+		Config* profile = &mod->profiles[profileIndex];
+		profile->images.resize(profile->imagePaths.size());
+		forloop(i, profile->imagePaths.size())
+		{
+			profile->images[i] = acquireTexture(textures, profile->imagePaths[i]);
+		}
+	}
+	if (!textures->loadOnRequest) {
+		loadTextures(textures, jobs);
+	}
+}
+
+void releaseConfigImages(ConfigSet* mod, TextureCache* textures)
+{
+	forloop(profileIndex, mod->profiles.size())
+	{
+		Config* profile = &mod->profiles[profileIndex];
+		forloop(i, profile->images.size())
+		{
+			releaseTexture(textures, profile->images[i]);
+		}
+		profile->images.clear();
+	}
+}
+
+// Start loading any of a profile's images that aren't loaded, so it can be switched to without placeholders
+void requestProfileImages(const Config& profile, TextureCache* textures, JobQueue* jobs)
+{
+	forloop(i, profile.images.size())
+	{
+		requestTexture(textures, jobs, profile.images[i]);
+	}
+}
+
+bool profileImagesLoaded(const Config& profile, const TextureCache& textures)
+{
+	forloop(i, profile.images.size())
+	{
+		if (!textures.entries[profile.images[i]].loaded) return false;
+	}
+	return true;
+}
+
+// Index of the profile a hotkey switches to, or -1
+int findProfileForHotkey(const ConfigSet& config, uint key)
+{
+	forloop(i, config.profiles.size())
+	{
+		// 0 means the profile has no hotkey, not a key that could be pressed
+		if (config.profiles[i].hotkey && config.profiles[i].hotkey == key) return i;
+	}
+	return -1;
+}
+
+// Index of the profile with the given name, or -1
+int findProfile(const ConfigSet& config, const std::string& name)
+{
+	forloop(i, config.profiles.size())
+	{
+		if (config.profiles[i].name == name) return i;
+	}
+	return -1;
+}
+
+// Maps joystick GUIDs and names to the profiles that list them
+typedef std::unordered_map<std::string, uint> JoystickProfileIndex;
+
+void indexJoystickProfiles(const ConfigSet& config, JoystickProfileIndex* out)
+{
+	out->clear();
+	forloop(profileIndex, config.profiles.size())
+	{
+		const Config& profile = config.profiles[profileIndex];
+		forloop(i, profile.joysticks.size())
+		{
+			// The first profile to list a joystick gets it
+			out->insert(std::make_pair(profile.joysticks[i], profileIndex));
+		}
+	}
+}
+
+// The profile for a joystick, matching its GUID before its name. Returns 0 if no profile lists it.
+const Config* findJoystickProfile(const ConfigSet& config, const JoystickProfileIndex& index, const char* guid, const char* name)
+{
+	JoystickProfileIndex::const_iterator found = index.find(guid);
+	if (found == index.end()) found = index.find(name);
+	if (found == index.end()) return 0;
+	return &config.profiles[found->second];
+}
@@ -0,0 +1,109 @@
+// Lets other programs, like a stream deck or a script, switch profiles through a local connection.
+// Commands are lines of text, and each gets a one line reply:
+//   profile <name>   switch to the named profile
+//   profiles         list the profile names, separated by spaces
+// Connections are polled once per frame and never block the program.
+struct ControlServer
+{
+	struct Client
+	{
+		Socket socket;
+		// Text received that doesn't make up a whole line yet
+		std::string received;
+	};
+	Socket listener;
+	std::vector<Client> clients;
+};
+
+bool startControlServer(ControlServer* out, uint port)
+{
+	startSockets();
+	out->listener = listenOnLocalPort(port);
+	return out->listener != invalidSocket;
+}
+
+void stopControlServer(ControlServer* mod)
+{
+	forloop(i, mod->clients.size())
+	{
+		closeSocket(mod->clients[i].socket);
+	}
+	mod->clients.clear();
+	if (mod->listener != invalidSocket) {
+		closeSocket(mod->listener);
+	}
+}
+
+// Replies are short, so one that doesn't fit in the connection's buffer is dropped rather than waited on
+void sendControlReply(ControlServer::Client* client, const std::string& reply)
+{
+	sendBytes(client->socket, reply.c_str(), reply.size());
+}
+
+// Returns the index of the profile to switch to, or -1
+int runControlCommand(ControlServer::Client* client, const std::string& line, const ConfigSet& config)
+{
+	if (line.compare(0, 8, "profile ") == 0) {
+		std::string name = line.substr(8);
+		int profile = findProfile(config, name);
+		if (profile < 0) {
+			sendControlReply(client, "error: there's no profile called " + name + "\n");
+		}
+		else {
+			sendControlReply(client, "ok\n");
+		}
+		return profile;
+	}
+	if (line == "profiles") {
+		std::string reply;
+		forloop(i, config.profiles.size())
+		{
+			if (i) reply += ' ';
+			reply += config.profiles[i].name;
+		}
+		sendControlReply(client, reply + "\n");
+		return -1;
+	}
+	sendControlReply(client, "error: unknown command\n");
+	return -1;
+}
+
+// Accept new connections and run any commands that have arrived. Returns the index of the profile
+// the last command asked for, or -1.
+int pollControlServer(ControlServer* mod, const ConfigSet& config)
+{
+	if (mod->listener == invalidSocket) return -1;
+	Socket connection;
+	while ((connection = acceptConnection(mod->listener)) != invalidSocket) {
+		ControlServer::Client client;
+		client.socket = connection;
+		mod->clients.push_back(client);
+	}
+
+	int requestedProfile = -1;
+	for (uint i=0; i<mod->clients.size();) {
+		ControlServer::Client* client = &mod->clients[i];
+		char buffer[256];
+		int received;
+		while ((received = receiveBytes(client->socket, buffer, sizeof(buffer))) > 0) {
+			client->received.append(buffer, received);
+		}
+		size_t lineEnd;
+		while ((lineEnd = client->received.find('\n')) != std::string::npos) {
+			std::string line = client->received.substr(0, lineEnd);
+			client->received.erase(0, lineEnd+1);
+			if (line.size() && line[line.size()-1] == '\r') line.erase(line.size()-1);
+			int profile = runControlCommand(client, line, config);
+			if (profile >= 0) requestedProfile = profile;
+		}
+		// Closed connections, and ones sending lines far longer than any command, are dropped
+		if (received < 0 || client->received.size() > 4096) {
+			closeSocket(client->socket);
+			mod->clients.erase(mod->clients.begin() + i);
+		}
+		else {
+			++i;
+		}
+	}
+	return requestedProfile;
+}
@@ -1,4 +1,9 @@
+#ifdef WIN32
 #include <gl/GL.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <algorithm>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
@@ -7,52 +12,226 @@ struct Texture
 	GLuint id;
 };
 
+// Decoded RGBA pixels with premultiplied alpha, top row first
+struct Image
+{
+	unsigned char* pixels;
+	int width, height;
+};
+
 struct Color
 {
 	float r, g, b;
 };
 
+// Pixels to draw into without OpenGL: RGBA with premultiplied alpha, top row first, stride bytes apart
+struct PixelBuffer
+{
+	unsigned char* pixels;
+	int width, height;
+	int stride;
+};
+
+// A copy of the window's framebuffer kept in a texture.
+// OpenGL 1.1 can't render into a texture, so the frame is drawn normally and copied back afterwards.
+struct FramebufferCopy
+{
+	Texture texture;
+	int width, height;
+	// The texture is allocated with power of two dimensions and only partially used
+	int textureWidth, textureHeight;
+};
+
+// Number of draws issued since it was last reset, shown by the performance HUD
+uint drawCallCount = 0;
+
 void setupOpenGL()
 {
 	glEnable(GL_TEXTURE_2D);
 	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	// Images have premultiplied alpha
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 }
 
-void createTextureFromImage(Texture* out, const char* filePath)
+// Set up drawing to a part of the window to use pixel coordinates, with the origin at the bottom left of the part
+void setViewportArea(int x, int y, int width, int height)
 {
-	int width, height, channels;
-	unsigned char* imageData = stbi_load(filePath, &width, &height, &channels, 0);
-	if (imageData) {
-		GLuint textureID;
-		glGenTextures(1, &textureID);
-		GLenum pixelFormat = (channels == 4)? GL_RGBA : GL_RGBA;
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, pixelFormat, width, height, 0, pixelFormat, GL_UNSIGNED_BYTE, imageData);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		stbi_image_free(imageData);
+	glViewport(x, y, width, height);
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	glOrtho(0, width, 0, height, -1, 1);
+	glMatrixMode(GL_MODELVIEW);
+}
+
+// Set up drawing to use pixel coordinates, with the origin at the bottom left of the window
+void setViewport(int width, int height)
+{
+	setViewportArea(0, 0, width, height);
+}
 
-		out->id = textureID;
+// Textures are drawn with premultiplied alpha, so semi-transparent edges filter without dark fringes
+void premultiplyAlpha(Image* mod)
+{
+	unsigned char* pixel = mod->pixels;
+	forloop(i, (uint)(mod->width*mod->height))
+	{
+		uint alpha = pixel[3];
+		pixel[0] = (unsigned char)((pixel[0]*alpha + 127) / 255);
+		pixel[1] = (unsigned char)((pixel[1]*alpha + 127) / 255);
+		pixel[2] = (unsigned char)((pixel[2]*alpha + 127) / 255);
+		pixel += 4;
 	}
 }
 
-void renderImage(Texture texture, float x, float y, float width, float height)
+// Decoding doesn't touch OpenGL, so it can be done on any thread
+bool loadImage(Image* out, const char* filePath)
+{
+	// Always expand to 4 channels so every image can be uploaded as RGBA
+	int channels;
+	out->pixels = stbi_load(filePath, &out->width, &out->height, &channels, 4);
+	if (out->pixels) premultiplyAlpha(out);
+	return out->pixels != 0;
+}
+
+bool loadImageFromMemory(Image* out, const unsigned char* data, size_t size)
+{
+	int channels;
+	out->pixels = stbi_load_from_memory(data, (int)size, &out->width, &out->height, &channels, 4);
+	if (out->pixels) premultiplyAlpha(out);
+	return out->pixels != 0;
+}
+
+void freeImage(Image* mod)
+{
+	stbi_image_free(mod->pixels);
+	mod->pixels = 0;
+}
+
+void createTexture(Texture* out, Image image)
+{
+	GLuint textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	out->id = textureID;
+}
+
+void renderImage(Texture texture, int x, int y, int width, int height)
 {
+	++drawCallCount;
 	glBindTexture(GL_TEXTURE_2D, texture.id);
 	// Draw a quad with two triangles
 	glBegin(GL_TRIANGLE_STRIP);
 	// Bottom left
 	glTexCoord2f(0, 1);
-	glVertex3f(-1+x, -1+y, 0);
+	glVertex2i(x, y);
 	// Bottom right
 	glTexCoord2f(1, 1);
-	glVertex3f(-1+x+width, -1+y, 0);
+	glVertex2i(x+width, y);
 	// Top left
 	glTexCoord2f(0, 0);
-	glVertex3f(-1+x, -1+y+height, 0);
+	glVertex2i(x, y+height);
 	// Top right
 	glTexCoord2f(1, 0);
-	glVertex3f(-1+x+width, -1+y+height, 0);
+	glVertex2i(x+width, y+height);
 	glEnd();
-}
\ No newline at end of file
+}
+
+int nextPowerOfTwo(int value)
+{
+	int result = 1;
+	while (result < value) result *= 2;
+	return result;
+}
+
+void resizeFramebufferCopy(FramebufferCopy* mod, int width, int height)
+{
+	if (!mod->texture.id) {
+		glGenTextures(1, &mod->texture.id);
+	}
+	mod->width = width;
+	mod->height = height;
+	int textureWidth = nextPowerOfTwo(width);
+	int textureHeight = nextPowerOfTwo(height);
+	glBindTexture(GL_TEXTURE_2D, mod->texture.id);
+	if (textureWidth != mod->textureWidth || textureHeight != mod->textureHeight) {
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, textureWidth, textureHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+		// Copies are drawn at whole pixel offsets, so nearest filtering reproduces them exactly
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		mod->textureWidth = textureWidth;
+		mod->textureHeight = textureHeight;
+	}
+}
+
+// Copy the current contents of the back buffer into the texture
+void copyFramebuffer(FramebufferCopy* mod)
+{
+	glBindTexture(GL_TEXTURE_2D, mod->texture.id);
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, mod->width, mod->height);
+}
+
+// Draw the copy over the whole window, offset by x and y pixels.
+// Blending is disabled so the copied pixels, including alpha, replace what's there instead of being blended twice.
+void renderFramebufferCopy(FramebufferCopy copy, int x, int y)
+{
+	float u = float(copy.width)/float(copy.textureWidth);
+	float v = float(copy.height)/float(copy.textureHeight);
+	++drawCallCount;
+	glDisable(GL_BLEND);
+	glBindTexture(GL_TEXTURE_2D, copy.texture.id);
+	// Framebuffer rows are stored bottom up, so unlike images the texture isn't flipped
+	glBegin(GL_TRIANGLE_STRIP);
+	glTexCoord2f(0, 0);
+	glVertex2i(x, y);
+	glTexCoord2f(u, 0);
+	glVertex2i(x+copy.width, y);
+	glTexCoord2f(0, v);
+	glVertex2i(x, y+copy.height);
+	glTexCoord2f(u, v);
+	glVertex2i(x+copy.width, y+copy.height);
+	glEnd();
+	glEnable(GL_BLEND);
+}
+
+// Fill the buffer like glClear, with zero alpha
+void clearPixelBuffer(PixelBuffer buffer, Color color)
+{
+	unsigned char clear[4] ={(unsigned char)(color.r*255 + 0.5f), (unsigned char)(color.g*255 + 0.5f), (unsigned char)(color.b*255 + 0.5f), 0};
+	forloop(y, (uint)buffer.height)
+	{
+		unsigned char* pixel = buffer.pixels + (size_t)y*buffer.stride;
+		forloop(x, (uint)buffer.width)
+		{
+			memcpy(pixel + x*4, clear, 4);
+		}
+	}
+}
+
+// Draw an image scaled to width by height with its bottom left corner at x, y, like renderImage does
+// with blending. Uses nearest filtering, and clips to the buffer.
+void drawImageToBuffer(PixelBuffer buffer, Image image, int x, int y, int width, int height)
+{
+	if (!image.pixels || width <= 0 || height <= 0) return;
+	int top = buffer.height - (y + height);
+	int startRow = std::max(0, -top);
+	int endRow = std::min(height, buffer.height - top);
+	int startColumn = std::max(0, -x);
+	int endColumn = std::min(width, buffer.width - x);
+	for (int row=startRow; row<endRow; ++row) {
+		const unsigned char* sourceRow = image.pixels + (size_t)((2*row + 1)*image.height / (2*height))*image.width*4;
+		unsigned char* destination = buffer.pixels + (size_t)(top + row)*buffer.stride + (size_t)(x + startColumn)*4;
+		for (int column=startColumn; column<endColumn; ++column) {
+			const unsigned char* source = sourceRow + (size_t)((2*column + 1)*image.width / (2*width))*4;
+			// Premultiplied source over destination, the same as glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA)
+			uint inverseAlpha = 255 - source[3];
+			forloop(channel, 4)
+			{
+				destination[channel] = (unsigned char)(source[channel] + (destination[channel]*inverseAlpha + 127) / 255);
+			}
+			destination += 4;
+		}
+	}
+}
@@ -0,0 +1,256 @@
+// An overlay showing how well the program is keeping up, toggled with F12 or shown from the start with --hud.
+// All of its text is drawn from one small font texture in a single batch, so showing it adds one draw call.
+
+const uint hudKey = keyF1 + 11;
+
+// 5x7 pixel glyphs for ' ' to '_', one byte per row, top row first, with the leftmost pixel in bit 4.
+// Lowercase letters are drawn as uppercase.
+const unsigned char hudFont[64][7] =
+{
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // space
+	{0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04}, // !
+	{0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00}, // "
+	{0x0A, 0x1F, 0x0A, 0x0A, 0x1F, 0x0A, 0x00}, // #
+	{0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04}, // $
+	{0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}, // %
+	{0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D}, // &
+	{0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00}, // '
+	{0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02}, // (
+	{0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08}, // )
+	{0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00}, // *
+	{0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00}, // +
+	{0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08}, // ,
+	{0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}, // -
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}, // .
+	{0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}, // /
+	{0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}, // 0
+	{0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}, // 1
+	{0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}, // 2
+	{0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}, // 3
+	{0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}, // 4
+	{0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}, // 5
+	{0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}, // 6
+	{0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}, // 7
+	{0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}, // 8
+	{0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}, // 9
+	{0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}, // :
+	{0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08}, // ;
+	{0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02}, // <
+	{0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00}, // =
+	{0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08}, // >
+	{0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04}, // ?
+	{0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E}, // @
+	{0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, // A
+	{0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}, // B
+	{0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}, // C
+	{0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}, // D
+	{0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}, // E
+	{0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}, // F
+	{0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}, // G
+	{0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, // H
+	{0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}, // I
+	{0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}, // J
+	{0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}, // K
+	{0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}, // L
+	{0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}, // M
+	{0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}, // N
+	{0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // O
+	{0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}, // P
+	{0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}, // Q
+	{0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}, // R
+	{0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}, // S
+	{0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, // T
+	{0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // U
+	{0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}, // V
+	{0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}, // W
+	{0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}, // X
+	{0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x04}, // Y
+	{0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}, // Z
+	{0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E}, // [
+	{0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00}, // backslash
+	{0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E}, // ]
+	{0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00}, // ^
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F}, // _
+};
+
+struct PerformanceHud
+{
+	static const uint atlasWidth = 128;
+	static const uint atlasHeight = 64;
+	// Each glyph gets an 8x8 cell in the atlas, 16 to a row. The cell after the last glyph is solid, for the background.
+	static const uint cellSize = 8;
+	static const uint solidCell = 64;
+	// Glyphs are drawn at this many pixels per font pixel
+	static const uint scale = 2;
+	Texture atlas;
+	bool visible;
+
+	// Rates are averaged over about a second, so they're steady enough to read
+	uint64 periodStart;
+	uint periodFrames;
+	uint64 periodFrameTime;
+	uint64 periodMaxFrameTime;
+	uint periodPolls;
+	uint periodStartInsertCount;
+	uint64 previousFrameTime;
+	uint64 previousPollTime;
+
+	float frameMilliseconds;
+	float maxFrameMilliseconds;
+	float pollRate;
+	float eventRate;
+};
+
+void createHud(PerformanceHud* out)
+{
+	const uint width = PerformanceHud::atlasWidth;
+	const uint cellSize = PerformanceHud::cellSize;
+	std::vector<unsigned char> pixels(width * PerformanceHud::atlasHeight * 4, 0);
+	forloop(glyph, PerformanceHud::solidCell+1)
+	{
+		uint cellX = glyph%16 * cellSize;
+		uint cellY = glyph/16 * cellSize;
+		forloop(y, cellSize) forloop(x, cellSize)
+		{
+			bool set = glyph == PerformanceHud::solidCell || (x < 5 && y < 7 && (hudFont[glyph][y] & (0x10 >> x)));
+			if (set) memset(&pixels[((cellY+y)*width + cellX+x)*4], 255, 4);
+		}
+	}
+	Image image;
+	image.pixels = pixels.data();
+	image.width = width;
+	image.height = PerformanceHud::atlasHeight;
+	createTexture(&out->atlas, image);
+	// Glyphs are drawn at whole multiples of their size, so they stay sharp
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	out->visible = false;
+	out->periodStart = 0;
+}
+
+// Called once per frame, whether or not the HUD is showing, so the rates are ready when it's turned on.
+// insertCount is the total number of inputs ever added to the lists.
+void updateHudRates(PerformanceHud* mod, const Input& input, uint insertCount, uint64 now)
+{
+	if (!mod->periodStart) {
+		mod->periodStart = now;
+		mod->previousFrameTime = now;
+		mod->previousPollTime = input.pollTime;
+		mod->periodStartInsertCount = insertCount;
+		mod->periodFrames = 0;
+		mod->periodFrameTime = 0;
+		mod->periodMaxFrameTime = 0;
+		mod->periodPolls = 0;
+		return;
+	}
+	uint64 frameTime = now - mod->previousFrameTime;
+	mod->previousFrameTime = now;
+	++mod->periodFrames;
+	mod->periodFrameTime += frameTime;
+	if (frameTime > mod->periodMaxFrameTime) mod->periodMaxFrameTime = frameTime;
+	if (input.pollTime != mod->previousPollTime) {
+		++mod->periodPolls;
+		mod->previousPollTime = input.pollTime;
+	}
+
+	uint64 elapsed = now - mod->periodStart;
+	if (elapsed >= 1000000) {
+		float seconds = elapsed / 1000000.0f;
+		mod->frameMilliseconds = mod->periodFrameTime / 1000.0f / mod->periodFrames;
+		mod->maxFrameMilliseconds = mod->periodMaxFrameTime / 1000.0f;
+		mod->pollRate = mod->periodPolls / seconds;
+		mod->eventRate = (insertCount - mod->periodStartInsertCount) / seconds;
+		mod->periodStart = now;
+		mod->periodStartInsertCount = insertCount;
+		mod->periodFrames = 0;
+		mod->periodFrameTime = 0;
+		mod->periodMaxFrameTime = 0;
+		mod->periodPolls = 0;
+	}
+}
+
+// Add a quad to the batch, showing the given atlas cell or the middle of it
+void addHudQuad(uint cell, bool wholeCell, int x, int y, int width, int height)
+{
+	float cellX = float(cell%16 * PerformanceHud::cellSize);
+	float cellY = float(cell/16 * PerformanceHud::cellSize);
+	float u0, v0, u1, v1;
+	if (wholeCell) {
+		u0 = cellX / PerformanceHud::atlasWidth;
+		v0 = cellY / PerformanceHud::atlasHeight;
+		u1 = (cellX + 5) / PerformanceHud::atlasWidth;
+		v1 = (cellY + 7) / PerformanceHud::atlasHeight;
+	}
+	else {
+		u0 = u1 = (cellX + 4) / PerformanceHud::atlasWidth;
+		v0 = v1 = (cellY + 4) / PerformanceHud::atlasHeight;
+	}
+	// The atlas's top row is first, like images
+	glTexCoord2f(u0, v1);
+	glVertex2i(x, y);
+	glTexCoord2f(u1, v1);
+	glVertex2i(x+width, y);
+	glTexCoord2f(u1, v0);
+	glVertex2i(x+width, y+height);
+	glTexCoord2f(u0, v0);
+	glVertex2i(x, y+height);
+}
+
+uint hudGlyph(char c)
+{
+	if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+	if (c < ' ' || c > '_') c = '?';
+	return c - ' ';
+}
+
+// Draw the HUD in the top left of the window. Call after everything else is drawn, so it's on top.
+void renderHud(const PerformanceHud& hud, uint storedInputs, uint visibleInputs, const TextureCache& textures,
+	const LatencyHistogram& latency, int windowHeight)
+{
+	TRACE_SCOPE("renderHud");
+	const uint lineCount = 6;
+	char lines[lineCount][64];
+	// Counting the HUD's own draw
+	uint drawCalls = drawCallCount + 1;
+	snprintf(lines[0], sizeof(lines[0]), "frame %.1f ms, max %.1f ms", hud.frameMilliseconds, hud.maxFrameMilliseconds);
+	snprintf(lines[1], sizeof(lines[1]), "input polls %.0f/s", hud.pollRate);
+	snprintf(lines[2], sizeof(lines[2]), "inputs %.1f/s", hud.eventRate);
+	snprintf(lines[3], sizeof(lines[3]), "draw calls %u, textures %.1f MB", drawCalls, textures.textureBytes / (1024.0*1024.0));
+	snprintf(lines[4], sizeof(lines[4]), "list %u stored, %u visible", storedInputs, visibleInputs);
+	snprintf(lines[5], sizeof(lines[5]), "latency %.1f ms", latency.last / 1000.0);
+
+	const int glyphWidth = 5 * PerformanceHud::scale;
+	const int glyphHeight = 7 * PerformanceHud::scale;
+	const int advance = glyphWidth + PerformanceHud::scale;
+	const int lineHeight = glyphHeight + 2*PerformanceHud::scale;
+	const int margin = 4 * PerformanceHud::scale;
+	size_t longestLine = 0;
+	forloop(i, lineCount)
+	{
+		longestLine = std::max(longestLine, strlen(lines[i]));
+	}
+	int panelWidth = int(longestLine)*advance + margin;
+	int panelHeight = int(lineCount)*lineHeight + margin;
+	int top = windowHeight;
+
+	glBindTexture(GL_TEXTURE_2D, hud.atlas.id);
+	glBegin(GL_QUADS);
+	// Colors are premultiplied, like images
+	glColor4f(0, 0, 0, 0.7f);
+	addHudQuad(PerformanceHud::solidCell, false, 0, top - panelHeight, panelWidth, panelHeight);
+	forloop(i, lineCount)
+	{
+		// Show the frame time in red if a frame took twice as long as usual, since that's a visible stutter
+		bool warn = i == 0 && hud.maxFrameMilliseconds > 2*hud.frameMilliseconds;
+		if (warn) glColor4f(1, 0.3f, 0.3f, 1);
+		else glColor4f(1, 1, 1, 1);
+		int y = top - margin/2 - int(i+1)*lineHeight + PerformanceHud::scale;
+		for (uint c=0; lines[i][c]; ++c) {
+			if (lines[i][c] == ' ') continue;
+			addHudQuad(hudGlyph(lines[i][c]), true, margin/2 + int(c)*advance, y, glyphWidth, glyphHeight);
+		}
+	}
+	glEnd();
+	glColor4f(1, 1, 1, 1);
+	++drawCallCount;
+}
@@ -0,0 +1,87 @@
+// Decoded images saved to disk, so later launches can map them straight into the texture upload instead of decoding.
+// Each source image has one file in the cache directory, named after a hash of its path,
+// holding a header followed by the premultiplied RGBA pixels.
+
+struct ImageCacheHeader
+{
+	static const uint expectedMagic = 0x43444449; // "IDDC"
+	static const uint expectedVersion = 1;
+	uint magic;
+	uint version;
+	// The source file the pixels were decoded from
+	uint64 sourceModifiedTime;
+	uint64 sourceSize;
+	uint64 contentHash;
+	uint width;
+	uint height;
+};
+
+// An image pointing into a mapped cache file
+struct CachedImage
+{
+	MappedFile file;
+	ImageCacheHeader header;
+	Image image;
+};
+
+std::string imageCacheFilePath(const std::string& cacheDirectory, const std::string& sourcePath)
+{
+	uint64 pathHash = hashBytes((const unsigned char*)sourcePath.data(), sourcePath.size());
+	char fileName[32];
+	snprintf(fileName, sizeof(fileName), "/%016llx.rgba", pathHash);
+	return cacheDirectory + fileName;
+}
+
+// Map the cache file for a source image. Fails if there isn't one or it's from another version of the program.
+// The caller decides whether the source has changed by comparing the header against it.
+bool openCachedImage(CachedImage* out, const std::string& cacheDirectory, const std::string& sourcePath)
+{
+	*out = CachedImage();
+	std::string cachePath = imageCacheFilePath(cacheDirectory, sourcePath);
+	if (!mapFile(&out->file, cachePath.c_str())) return false;
+	if (out->file.size >= sizeof(ImageCacheHeader)) {
+		memcpy(&out->header, out->file.data, sizeof(ImageCacheHeader));
+		size_t pixelBytes = (size_t)out->header.width*out->header.height*4;
+		if (out->header.magic == ImageCacheHeader::expectedMagic
+			&& out->header.version == ImageCacheHeader::expectedVersion
+			&& out->file.size == sizeof(ImageCacheHeader) + pixelBytes)
+		{
+			out->image.pixels = (unsigned char*)out->file.data + sizeof(ImageCacheHeader);
+			out->image.width = out->header.width;
+			out->image.height = out->header.height;
+			return true;
+		}
+	}
+	unmapFile(&out->file);
+	return false;
+}
+
+void closeCachedImage(CachedImage* mod)
+{
+	unmapFile(&mod->file);
+	mod->image = Image();
+}
+
+// Write a decoded image to the cache. Written to a temporary file first so a crash can't leave a truncated entry.
+void saveCachedImage(const std::string& cacheDirectory, const std::string& sourcePath, FileInfo source, uint64 contentHash, Image image)
+{
+	ImageCacheHeader header;
+	header.magic = ImageCacheHeader::expectedMagic;
+	header.version = ImageCacheHeader::expectedVersion;
+	header.sourceModifiedTime = source.modifiedTime;
+	header.sourceSize = source.size;
+	header.contentHash = contentHash;
+	header.width = image.width;
+	header.height = image.height;
+
+	std::string cachePath = imageCacheFilePath(cacheDirectory, sourcePath);
+	std::string temporaryPath = cachePath + ".tmp";
+	FILE* file = fopen(temporaryPath.c_str(), "wb");
+	if (!file) return;
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1
+		&& fwrite(image.pixels, (size_t)image.width*image.height*4, 1, file) == 1;
+	fclose(file);
+	if (!written || !replaceFile(temporaryPath.c_str(), cachePath.c_str())) {
+		remove(temporaryPath.c_str());
+	}
+}
\ No newline at end of file
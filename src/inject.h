@@ -0,0 +1,201 @@
+// Takes joystick input from another program, like an emulator or a bot, instead of reading real joysticks.
+// The program connects to a local port or Unix domain socket and sends one message per game frame:
+// an InjectedFrameHeader, then an InjectedJoystickState for each joystick, in the sender's native byte order.
+// Each frame's inputs are added to the list with the game's frame number, so inputs the game saw on the same
+// frame are always grouped together, however the frames line up with this program's.
+//
+// Injected joysticks are named "Injected 1", "Injected 2" and so on, so profiles can be picked for them by name.
+//
+// Only one program injects at a time, since every frame replaces the whole set of joysticks. Connections made
+// while another program is connected are closed straight away. A program that reconnects is accepted once its
+// old connection has closed, and its frames are read after the ones still left from the old connection.
+
+struct InjectedFrameHeader
+{
+	// The game's frame number. Frames should be sent in order, and inputs only group with others from the same frame.
+	uint frameNumber;
+	// Number of InjectedJoystickState that follow. Joysticks missing from a frame are disconnected.
+	uint joystickCount;
+};
+
+struct InjectedJoystickState
+{
+	// Bit n is set if button n is held
+	uint buttons;
+	// SDL hat bits
+	int hat;
+	// From -1 to 1
+	float axes[Input::Joystick::State::axisCount];
+};
+
+struct InjectionServer
+{
+	static const uint maxJoysticks = 8;
+	struct Client
+	{
+		Socket socket;
+		// Bytes received that haven't been read as a frame yet
+		static const uint bufferSize = 16*1024;
+		unsigned char received[bufferSize];
+		uint receivedSize;
+		// The other end closed the connection. It's dropped once the frames it sent have been read.
+		bool closed;
+	};
+	std::vector<Socket> listeners;
+	// The connected program first, then at most one waiting for the frames left from the first to be read
+	std::vector<Client> clients;
+	std::string socketPath;
+	// Handed to the mapping code in place of real joysticks
+	Input::Joystick joysticks[maxJoysticks];
+	uint joystickCount;
+};
+
+const char* injectedJoystickNames[InjectionServer::maxJoysticks] =
+{
+	"Injected 1", "Injected 2", "Injected 3", "Injected 4", "Injected 5", "Injected 6", "Injected 7", "Injected 8",
+};
+
+// Listen on a local TCP port, a Unix domain socket, or both. Pass 0 for either to not use it.
+bool startInjectionServer(InjectionServer* out, uint port, const char* socketPath)
+{
+	startSockets();
+	out->joystickCount = 0;
+	forloop(i, InjectionServer::maxJoysticks)
+	{
+		Input::Joystick* joystick = &out->joysticks[i];
+		memset(joystick, 0, sizeof(*joystick));
+		joystick->name = injectedJoystickNames[i];
+	}
+	if (port) {
+		Socket listener = listenOnLocalPort(port);
+		if (listener == invalidSocket) return false;
+		out->listeners.push_back(listener);
+	}
+	if (socketPath) {
+		Socket listener = listenOnLocalSocket(socketPath);
+		if (listener == invalidSocket) return false;
+		out->listeners.push_back(listener);
+		out->socketPath = socketPath;
+	}
+	return true;
+}
+
+void stopInjectionServer(InjectionServer* mod)
+{
+	forloop(i, mod->clients.size())
+	{
+		closeSocket(mod->clients[i].socket);
+	}
+	mod->clients.clear();
+	forloop(i, mod->listeners.size())
+	{
+		closeSocket(mod->listeners[i]);
+	}
+	mod->listeners.clear();
+	if (mod->socketPath.size()) {
+		remove(mod->socketPath.c_str());
+	}
+}
+
+// The size of the first frame a client sent, or 0 if it hasn't all arrived yet
+uint wholeInjectedFrameSize(const InjectionServer::Client& client)
+{
+	if (client.receivedSize < sizeof(InjectedFrameHeader)) return 0;
+	InjectedFrameHeader header;
+	memcpy(&header, client.received, sizeof(header));
+	uint64 frameSize = sizeof(header) + (uint64)header.joystickCount*sizeof(InjectedJoystickState);
+	return frameSize <= client.receivedSize ? (uint)frameSize : 0;
+}
+
+// Accept new connections and receive whatever has arrived, without blocking. Call once per frame,
+// then call readInjectedFrame until it returns false.
+void pollInjectionServer(InjectionServer* mod, Input* input)
+{
+	TRACE_SCOPE("pollInjectionServer");
+	// Nothing has changed until a frame is read
+	forloop(i, mod->joystickCount)
+	{
+		mod->joysticks[i].previous = mod->joysticks[i].current;
+	}
+	for (uint i=0; i<mod->clients.size();) {
+		InjectionServer::Client* client = &mod->clients[i];
+		int received = 0;
+		while (!client->closed && client->receivedSize < InjectionServer::Client::bufferSize
+			&& (received = receiveBytes(client->socket, client->received + client->receivedSize, InjectionServer::Client::bufferSize - client->receivedSize)) > 0)
+		{
+			client->receivedSize += received;
+		}
+		if (received < 0) client->closed = true;
+		if (client->closed && !wholeInjectedFrameSize(*client)) {
+			closeSocket(client->socket);
+			mod->clients.erase(mod->clients.begin() + i);
+		}
+		else {
+			++i;
+		}
+	}
+	forloop(i, mod->listeners.size())
+	{
+		Socket connection;
+		while ((connection = acceptConnection(mod->listeners[i])) != invalidSocket) {
+			if (mod->clients.size() && !mod->clients.back().closed) {
+				fprintf(stderr, "closed an injection connection, since another program is already injecting\n");
+				closeSocket(connection);
+				continue;
+			}
+			mod->clients.push_back(InjectionServer::Client());
+			mod->clients.back().socket = connection;
+			mod->clients.back().receivedSize = 0;
+			mod->clients.back().closed = false;
+		}
+	}
+	input->joysticks = mod->joysticks;
+	input->joystickCount = mod->joystickCount;
+	input->joysticksChanged = false;
+}
+
+// Apply the next frame received from the connected program to the input. Returns false if there are no whole frames left.
+// A program sending frames with too many joysticks is disconnected.
+bool readInjectedFrame(InjectionServer* mod, Input* input, uint* out_frameNumber)
+{
+	if (mod->clients.empty()) return false;
+	InjectionServer::Client* client = &mod->clients[0];
+	if (client->receivedSize < sizeof(InjectedFrameHeader)) return false;
+	InjectedFrameHeader header;
+	memcpy(&header, client->received, sizeof(header));
+	if (header.joystickCount > InjectionServer::maxJoysticks) {
+		fprintf(stderr, "injected frame %u has %u joysticks, but at most %u are supported\n", header.frameNumber, header.joystickCount, InjectionServer::maxJoysticks);
+		closeSocket(client->socket);
+		mod->clients.erase(mod->clients.begin());
+		return false;
+	}
+	uint frameSize = wholeInjectedFrameSize(*client);
+	if (!frameSize) return false;
+
+	const unsigned char* states = client->received + sizeof(header);
+	forloop(joystickIndex, header.joystickCount)
+	{
+		InjectedJoystickState state;
+		memcpy(&state, states + joystickIndex*sizeof(state), sizeof(state));
+		Input::Joystick* joystick = &mod->joysticks[joystickIndex];
+		// Joysticks that just connected start with nothing held
+		if (joystickIndex >= mod->joystickCount) memset(&joystick->current, 0, sizeof(joystick->current));
+		joystick->previous = joystick->current;
+		forloop(button, Input::Joystick::State::buttonCount)
+		{
+			joystick->current.buttons[button] = (state.buttons >> button) & 1;
+		}
+		joystick->current.hat = state.hat;
+		memcpy(joystick->current.axes, state.axes, sizeof(state.axes));
+	}
+	input->joysticksChanged = header.joystickCount != mod->joystickCount;
+	mod->joystickCount = header.joystickCount;
+	input->joysticks = mod->joysticks;
+	input->joystickCount = mod->joystickCount;
+	input->pollTime = getMicroseconds();
+	*out_frameNumber = header.frameNumber;
+
+	client->receivedSize -= frameSize;
+	memmove(client->received, client->received + frameSize, client->receivedSize);
+	return true;
+}
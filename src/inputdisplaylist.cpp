@@ -0,0 +1,277 @@
+// The library behind inputdisplaylist.h. Built on its own, without main.cpp, so it doesn't open a window or
+// read joysticks: the program embedding it pushes joystick state and draws the list where it wants.
+// Exceptions can't cross the C interface, so every exported function that can allocate or start threads
+// catches them and returns as if it had failed.
+#include "platform.h"
+#include "graphics.h"
+#include <cstdio>
+#include <new>
+#include <string>
+#include <vector>
+#include "trace.h"
+#include "jobs.h"
+#include "imagecache.h"
+#include "textures.h"
+#include "motion.h"
+#include "config.h"
+#include "bundle.h"
+#include "inputlist.h"
+#define IDL_BUILDING_LIBRARY
+#include "inputdisplaylist.h"
+
+struct IdlContext
+{
+	ConfigSet configs;
+	uint activeProfile;
+	TextureCache textures;
+	JobQueue jobs;
+	bool useOpenGL;
+	std::string errors;
+
+	Input input;
+	Input::Joystick joysticks[IDL_MAX_JOYSTICKS];
+	// State set since the last idlEndFrame, applied to the joysticks when it's called
+	Input::Joystick::State pending[IDL_MAX_JOYSTICKS];
+	uint pendingJoystickCount;
+
+	// The list, with the direction and motion state that carry over between frames
+	PlayerInputs player;
+	InputLayout layout;
+};
+
+static_assert(IDL_BUTTON_COUNT == Input::Joystick::State::buttonCount, "IdlJoystickState doesn't match Input::Joystick::State");
+static_assert(IDL_AXIS_COUNT == Input::Joystick::State::axisCount, "IdlJoystickState doesn't match Input::Joystick::State");
+
+int idlGetApiVersion(void)
+{
+	return IDL_API_VERSION;
+}
+
+IdlContext* idlCreate(const char* configPath, unsigned int flags)
+{
+	IdlContext* context = new (std::nothrow) IdlContext;
+	if (!context) return 0;
+	try {
+		context->useOpenGL = (flags & IDL_CREATE_OPENGL) != 0;
+		context->textures.keepPixels = !context->useOpenGL;
+		startJobQueue(&context->jobs);
+
+		if (isBundleFile(configPath)) {
+			std::string bundleError;
+			if (!loadBundle(&context->configs, &context->textures, configPath, &bundleError)) {
+				context->errors = std::string(configPath) + ": " + bundleError + "\n";
+			}
+		}
+		else {
+			std::vector<ConfigError> errors;
+			parseConfigFile(&context->configs, configPath, &errors);
+			context->errors = formatConfigErrors(configPath, errors);
+			loadConfigImages(&context->configs, &context->textures, &context->jobs);
+		}
+		if (context->configs.profiles.empty()) {
+			context->configs.profiles.push_back(Config());
+		}
+		context->activeProfile = 0;
+
+		memset(&context->input, 0, sizeof(context->input));
+		memset(context->joysticks, 0, sizeof(context->joysticks));
+		memset(context->pending, 0, sizeof(context->pending));
+		forloop(i, IDL_MAX_JOYSTICKS)
+		{
+			context->joysticks[i].name = "";
+		}
+		context->input.joysticks = context->joysticks;
+		context->pendingJoystickCount = 0;
+		context->player = PlayerInputs();
+		context->layout = InputLayout();
+		return context;
+	}
+	catch (...) {
+		idlDestroy(context);
+		return 0;
+	}
+}
+
+void idlDestroy(IdlContext* context)
+{
+	if (!context) return;
+	try {
+		stopJobQueue(&context->jobs);
+		forloop(i, context->player.list.inputs.size())
+		{
+			releaseTexture(&context->textures, context->player.list.inputs[i].image);
+		}
+		releaseConfigImages(&context->configs, &context->textures);
+	}
+	catch (...) {
+	}
+	delete context;
+}
+
+const char* idlGetErrors(const IdlContext* context)
+{
+	return context->errors.c_str();
+}
+
+int idlSetProfile(IdlContext* context, const char* profileName)
+{
+	try {
+		int profile = findProfile(context->configs, profileName);
+		if (profile < 0) return 0;
+		context->activeProfile = profile;
+		context->layout.valid = false;
+		return 1;
+	}
+	catch (...) {
+		return 0;
+	}
+}
+
+// Joysticks past the highest one set so far count as connected from now on
+Input::Joystick::State* getPendingState(IdlContext* context, uint joystick)
+{
+	if (joystick >= IDL_MAX_JOYSTICKS) return 0;
+	if (joystick >= context->pendingJoystickCount) context->pendingJoystickCount = joystick+1;
+	return &context->pending[joystick];
+}
+
+void idlSetButton(IdlContext* context, unsigned int joystick, unsigned int button, int pressed)
+{
+	Input::Joystick::State* state = getPendingState(context, joystick);
+	if (state && button < IDL_BUTTON_COUNT) state->buttons[button] = pressed != 0;
+}
+
+void idlSetHat(IdlContext* context, unsigned int joystick, int hat)
+{
+	Input::Joystick::State* state = getPendingState(context, joystick);
+	if (state) state->hat = hat;
+}
+
+void idlSetAxis(IdlContext* context, unsigned int joystick, unsigned int axis, float value)
+{
+	Input::Joystick::State* state = getPendingState(context, joystick);
+	if (state && axis < IDL_AXIS_COUNT) state->axes[axis] = value;
+}
+
+void idlEndFrame(IdlContext* context, unsigned int frameNumber)
+{
+	try {
+		Input* input = &context->input;
+		forloop(i, context->pendingJoystickCount)
+		{
+			Input::Joystick* joystick = &context->joysticks[i];
+			// Joysticks that just connected start with nothing held
+			if (i >= input->joystickCount) memset(&joystick->current, 0, sizeof(joystick->current));
+			joystick->previous = joystick->current;
+			joystick->current = context->pending[i];
+		}
+		input->joystickCount = context->pendingJoystickCount;
+		input->pollTime = getMicroseconds();
+		const Config& profile = context->configs.profiles[context->activeProfile];
+		recordPlayerInputs(&context->player, 1, *input, profile, &context->textures, &context->jobs, frameNumber);
+	}
+	catch (...) {
+		// The frame is dropped, and the list carries on from the next one
+	}
+}
+
+void idlPushFrame(IdlContext* context, unsigned int frameNumber, const IdlJoystickState* joysticks, unsigned int joystickCount)
+{
+	joystickCount = std::min(joystickCount, (uint)IDL_MAX_JOYSTICKS);
+	forloop(i, joystickCount)
+	{
+		Input::Joystick::State* state = &context->pending[i];
+		forloop(button, IDL_BUTTON_COUNT)
+		{
+			state->buttons[button] = (joysticks[i].buttons >> button) & 1;
+		}
+		state->hat = joysticks[i].hat;
+		memcpy(state->axes, joysticks[i].axes, sizeof(state->axes));
+	}
+	context->pendingJoystickCount = joystickCount;
+	idlEndFrame(context, frameNumber);
+}
+
+unsigned int idlGetEntryCount(const IdlContext* context)
+{
+	return context->player.list.inputs.size();
+}
+
+unsigned int idlGetEntries(const IdlContext* context, IdlEntry* out, unsigned int maxCount)
+{
+	const InputDisplayList& list = context->player.list;
+	uint count = std::min(maxCount, (uint)list.inputs.size());
+	forloop(i, count)
+	{
+		out[i].id = list.insertCount-1 - i;
+		out[i].frameNumber = list.inputs[i].frameNumber;
+		out[i].inputTime = list.inputs[i].inputTime;
+		out[i].image = list.inputs[i].image;
+	}
+	return count;
+}
+
+const char* idlGetImagePath(const IdlContext* context, unsigned int image)
+{
+	if (image >= context->textures.entries.size()) return "";
+	return context->textures.entries[image].path.c_str();
+}
+
+unsigned int idlRenderGL(IdlContext* context, int width, int height, int clearBackground)
+{
+	try {
+		if (!context->useOpenGL) return 0;
+		const Config& config = context->configs.profiles[context->activeProfile];
+		updateInputLayout(&context->layout, context->player.list, context->textures, config.imageWidth, config.imageHeight, width, height);
+
+		// Leave the caller's state as it was
+		glPushAttrib(GL_ALL_ATTRIB_BITS);
+		glMatrixMode(GL_PROJECTION);
+		glPushMatrix();
+		glLoadIdentity();
+		glOrtho(0, width, 0, height, -1, 1);
+		glMatrixMode(GL_MODELVIEW);
+		glPushMatrix();
+		glLoadIdentity();
+		setupOpenGL();
+		glColor4f(1, 1, 1, 1);
+		if (clearBackground) {
+			GLint viewport[4];
+			glGetIntegerv(GL_VIEWPORT, viewport);
+			glEnable(GL_SCISSOR_TEST);
+			glScissor(viewport[0], viewport[1], width, height);
+			glClearColor(config.backgroundColor.r, config.backgroundColor.g, config.backgroundColor.b, 0);
+			glClear(GL_COLOR_BUFFER_BIT);
+		}
+		uint drawn = renderInputList(context->layout, config.imageWidth, config.imageHeight);
+		glMatrixMode(GL_MODELVIEW);
+		glPopMatrix();
+		glMatrixMode(GL_PROJECTION);
+		glPopMatrix();
+		glMatrixMode(GL_MODELVIEW);
+		glPopAttrib();
+		return drawn;
+	}
+	catch (...) {
+		return 0;
+	}
+}
+
+unsigned int idlRenderBuffer(IdlContext* context, unsigned char* pixels, int width, int height, int stride, int clearBackground)
+{
+	try {
+		if (context->useOpenGL) return 0;
+		const Config& config = context->configs.profiles[context->activeProfile];
+		updateInputLayout(&context->layout, context->player.list, context->textures, config.imageWidth, config.imageHeight, width, height);
+		PixelBuffer buffer;
+		buffer.pixels = pixels;
+		buffer.width = width;
+		buffer.height = height;
+		buffer.stride = stride;
+		if (clearBackground) clearPixelBuffer(buffer, config.backgroundColor);
+		return renderInputLayoutToBuffer(buffer, context->layout, context->player.list, context->textures, config.imageWidth, config.imageHeight);
+	}
+	catch (...) {
+		return 0;
+	}
+}
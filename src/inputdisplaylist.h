@@ -0,0 +1,98 @@
+/* C interface to the input display, for showing it inside another program instead of in its own window.
+ * The library takes joystick state from the program, maps it to images with a config file, keeps the list
+ * of displayed inputs, and draws the list into an OpenGL context or a pixel buffer.
+ *
+ * A context isn't thread safe, but separate contexts can be used on separate threads.
+ * Contexts created with IDL_CREATE_OPENGL need the same OpenGL context current whenever they're created,
+ * rendered or destroyed.
+ */
+#ifndef INPUT_DISPLAY_LIST_H
+#define INPUT_DISPLAY_LIST_H
+
+#if defined(_WIN32) && defined(IDL_BUILDING_LIBRARY)
+#define IDL_API __declspec(dllexport)
+#elif defined(_WIN32)
+#define IDL_API __declspec(dllimport)
+#else
+#define IDL_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Incremented when the interface changes in a way that breaks programs built against an older version */
+#define IDL_API_VERSION 1
+
+#define IDL_MAX_JOYSTICKS 8
+#define IDL_BUTTON_COUNT 32
+#define IDL_AXIS_COUNT 16
+
+/* Flags for idlCreate */
+/* Upload images to the current OpenGL context and draw with idlRenderGL. Otherwise images are kept in memory for idlRenderBuffer. */
+#define IDL_CREATE_OPENGL 1
+
+typedef struct IdlContext IdlContext;
+
+typedef struct IdlJoystickState
+{
+	/* Bit n is set if button n is held */
+	unsigned int buttons;
+	/* SDL hat bits: 1 up, 2 right, 4 down, 8 left */
+	int hat;
+	/* From -1 to 1 */
+	float axes[IDL_AXIS_COUNT];
+} IdlJoystickState;
+
+typedef struct IdlEntry
+{
+	/* Numbers inputs in the order they were added, starting from 0 */
+	unsigned int id;
+	/* The frame number the input was pushed with. Inputs with the same frame number are drawn together. */
+	unsigned int frameNumber;
+	/* When the input was pushed, in microseconds from an arbitrary starting point */
+	unsigned long long inputTime;
+	/* Pass to idlGetImagePath */
+	unsigned int image;
+} IdlEntry;
+
+IDL_API int idlGetApiVersion(void);
+
+/* Load a config file or baked bundle. Returns 0 only if out of memory or the worker threads can't be
+ * started; problems with the config are reported by idlGetErrors. Starts with the config's first profile. */
+IDL_API IdlContext* idlCreate(const char* configPath, unsigned int flags);
+IDL_API void idlDestroy(IdlContext* context);
+/* Errors found in the config file, one per line, or an empty string */
+IDL_API const char* idlGetErrors(const IdlContext* context);
+/* Returns 1, or 0 if there's no profile with that name */
+IDL_API int idlSetProfile(IdlContext* context, const char* profileName);
+
+/* Change one part of a joystick's state for the next idlEndFrame. Joysticks are numbered from 0,
+ * and every joystick up to the highest one set is treated as connected. */
+IDL_API void idlSetButton(IdlContext* context, unsigned int joystick, unsigned int button, int pressed);
+IDL_API void idlSetHat(IdlContext* context, unsigned int joystick, int hat);
+IDL_API void idlSetAxis(IdlContext* context, unsigned int joystick, unsigned int axis, float value);
+/* Add the inputs pressed since the last frame to the list, using the caller's frame number */
+IDL_API void idlEndFrame(IdlContext* context, unsigned int frameNumber);
+/* Set every joystick's state at once and end the frame */
+IDL_API void idlPushFrame(IdlContext* context, unsigned int frameNumber, const IdlJoystickState* joysticks, unsigned int joystickCount);
+
+IDL_API unsigned int idlGetEntryCount(const IdlContext* context);
+/* Copy up to maxCount entries, newest first. Returns the number copied. */
+IDL_API unsigned int idlGetEntries(const IdlContext* context, IdlEntry* out, unsigned int maxCount);
+/* The path of an entry's image. Valid until the context is destroyed. */
+IDL_API const char* idlGetImagePath(const IdlContext* context, unsigned int image);
+
+/* Draw the list to fill a width by height area, with the origin at the bottom left of the current viewport.
+ * OpenGL state is saved and restored. Fills the area with the config's background color first if
+ * clearBackground is set. Returns the number of inputs drawn. */
+IDL_API unsigned int idlRenderGL(IdlContext* context, int width, int height, int clearBackground);
+/* Draw the list into RGBA pixels with premultiplied alpha, top row first, with stride bytes between rows.
+ * Inputs are blended over what's in the buffer unless clearBackground is set. Returns the number of inputs drawn. */
+IDL_API unsigned int idlRenderBuffer(IdlContext* context, unsigned char* pixels, int width, int height, int stride, int clearBackground);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,466 @@
+// The list of displayed inputs, and how it's laid out and drawn.
+// Inputs are added at the front of the list and drop off the back.
+struct InputDisplay
+{
+	// TextureCache id
+	uint image;
+	uint frameNumber;
+	// When the input was read, in getMicroseconds time
+	uint64 inputTime;
+};
+
+struct InputDisplayList
+{
+	std::vector<InputDisplay> inputs;
+	// Total number of inputs ever added, used to find the inputs that are new since the last render
+	uint insertCount;
+	// Number of runs of inputs sharing a frame number, which are drawn overlapped in one slot
+	uint groupCount;
+};
+
+// Where an input is drawn, in pixels from the bottom left of the window
+struct InputQuad
+{
+	Texture image;
+	int x, y;
+};
+
+// Positions of the inputs that fit in the window, front of the list first
+struct InputLayout
+{
+	std::vector<InputQuad> quads;
+	// What the layout was computed for
+	uint insertCount;
+	uint textureVersion;
+	int windowWidth, windowHeight;
+	bool valid;
+};
+
+// Keeps the rendered list in a texture. Since inputs are only added at the front of the list,
+// a new input shifts everything else back by one slot, so only the new input needs to be drawn.
+struct RenderCache
+{
+	FramebufferCopy frame;
+	uint renderedInsertCount;
+	uint renderedInputCount;
+	uint renderedTextureVersion;
+	bool valid;
+};
+
+// Check if an input is currently active
+bool checkInputAction(Input::Joystick::State joystick, InputAction action)
+{
+	if (action.type == InputAction::Type_button
+		&& action.button.buttonIndex < joystick.buttonCount
+		&& joystick.buttons[action.button.buttonIndex])
+	{
+		return true;
+	}
+
+	if (action.type == InputAction::Type_hat
+		&& joystick.hat & action.hat.pov)
+	{
+		return true;
+	}
+
+	if (action.type == InputAction::Type_axis
+		&& action.axis.axisIndex < joystick.axisCount)
+	{
+		float axisCurrent = joystick.axes[action.axis.axisIndex];
+		if (action.axis.triggerPosition < action.axis.restPosition
+			&& axisCurrent <= action.axis.triggerPosition)
+		{
+			return true;
+		}
+		if (action.axis.triggerPosition > action.axis.restPosition
+			&& axisCurrent >= action.axis.triggerPosition)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Number of slots along the list that are at least partly inside the window.
+// None with a zero image size, which is what a config that couldn't be read has.
+uint countVisibleSlots(uint imageWidth, uint imageHeight, int windowWidth, int windowHeight)
+{
+	if (imageWidth == 0 || imageHeight == 0) return 0;
+	if (windowWidth > windowHeight) return (windowWidth + imageWidth - 1) / imageWidth;
+	else return (windowHeight + imageHeight - 1) / imageHeight;
+}
+
+// Work out the pixel position of every input that fits in the window.
+// Only redone when an input was added or the window changed size, so rendering just walks the quads.
+void updateInputLayout(InputLayout* mod, const InputDisplayList& list, const TextureCache& textures, uint imageWidth, uint imageHeight, int windowWidth, int windowHeight)
+{
+	TRACE_SCOPE("updateInputLayout");
+	if (mod->valid
+		&& mod->insertCount == list.insertCount
+		&& mod->textureVersion == textures.version
+		&& mod->windowWidth == windowWidth
+		&& mod->windowHeight == windowHeight)
+	{
+		return;
+	}
+	mod->valid = true;
+	mod->insertCount = list.insertCount;
+	mod->textureVersion = textures.version;
+	mod->windowWidth = windowWidth;
+	mod->windowHeight = windowHeight;
+	mod->quads.clear();
+
+	bool horizontal = windowWidth > windowHeight;
+	uint visibleSlots = countVisibleSlots(imageWidth, imageHeight, windowWidth, windowHeight);
+	// Inputs that happened on the same frame overlap, each one 60% of an image further along
+	int overlapOffset = horizontal ? int(imageHeight*0.6f + 0.5f) : int(imageWidth*0.6f + 0.5f);
+	uint slot = 0;
+	int overlap = 0;
+	for (uint i=0; i<list.inputs.size() && slot<visibleSlots; ++i)
+	{
+		InputQuad quad;
+		quad.image = getTexture(textures, list.inputs[i].image);
+		if (horizontal) {
+			quad.x = windowWidth - int(imageWidth*(slot+1));
+			quad.y = overlap;
+		}
+		else {
+			quad.x = overlap;
+			quad.y = windowHeight - int(imageHeight*(slot+1));
+		}
+		mod->quads.push_back(quad);
+
+		if (i<list.inputs.size()-1 && list.inputs[i].frameNumber == list.inputs[i+1].frameNumber) {
+			overlap += overlapOffset;
+		}
+		else {
+			overlap = 0;
+			++slot;
+		}
+	}
+}
+
+// Draw the first count quads of the layout and return how many were drawn
+uint renderInputLayout(const InputLayout& layout, uint count, uint imageWidth, uint imageHeight)
+{
+	if (count > layout.quads.size()) count = layout.quads.size();
+	forloop(i, count)
+	{
+		renderImage(layout.quads[i].image, layout.quads[i].x, layout.quads[i].y, imageWidth, imageHeight);
+	}
+	return count;
+}
+
+// Draw the layout without OpenGL, from the pixels a TextureCache keeps when keepPixels is set.
+// The layout's quads are in the same order as the list's inputs.
+uint renderInputLayoutToBuffer(PixelBuffer buffer, const InputLayout& layout, const InputDisplayList& list, const TextureCache& textures, uint imageWidth, uint imageHeight)
+{
+	TRACE_SCOPE("renderInputLayoutToBuffer");
+	forloop(i, layout.quads.size())
+	{
+		const TextureCache::Entry& entry = textures.entries[list.inputs[i].image];
+		if (!entry.loaded) continue;
+		drawImageToBuffer(buffer, textures.datas[entry.data].pixels, layout.quads[i].x, layout.quads[i].y, imageWidth, imageHeight);
+	}
+	return layout.quads.size();
+}
+
+uint renderInputList(const InputLayout& layout, uint imageWidth, uint imageHeight)
+{
+	TRACE_SCOPE("renderInputList");
+	return renderInputLayout(layout, layout.quads.size(), imageWidth, imageHeight);
+}
+
+// Render the list by scrolling the previous frame's image and drawing only the inputs added since.
+// Falls back to drawing the whole list when the window is resized, textures change, or the oldest visible inputs were removed.
+// Returns the number of inputs drawn this frame.
+uint renderCachedInputList(RenderCache* cache, const InputDisplayList& list, const InputLayout& layout, const Config& config, int windowWidth, int windowHeight)
+{
+	TRACE_SCOPE("renderCachedInputList");
+	bool horizontal = windowWidth > windowHeight;
+	uint newInputCount = list.insertCount - cache->renderedInsertCount;
+	bool fullRedraw = !cache->valid
+		|| cache->frame.width != windowWidth
+		|| cache->frame.height != windowHeight
+		|| cache->renderedTextureVersion != layout.textureVersion
+		|| newInputCount > list.inputs.size();
+
+	if (!fullRedraw && newInputCount > 0) {
+		// Inputs added on one frame share a slot. If they don't form exactly one group, shifting by a slot isn't enough.
+		uint newFrame = list.inputs[0].frameNumber;
+		if (list.inputs[newInputCount-1].frameNumber != newFrame
+			|| (newInputCount < list.inputs.size() && list.inputs[newInputCount].frameNumber == newFrame))
+		{
+			fullRedraw = true;
+		}
+		// Inputs dropped off the end of the list have to be erased if they are still on screen
+		bool droppedInputs = cache->renderedInputCount + newInputCount > list.inputs.size();
+		uint visibleSlots = countVisibleSlots(config.imageWidth, config.imageHeight, windowWidth, windowHeight);
+		if (droppedInputs && list.groupCount <= visibleSlots) {
+			fullRedraw = true;
+		}
+	}
+
+	glClearColor(config.backgroundColor.r, config.backgroundColor.g, config.backgroundColor.b, 0);
+	glClear(GL_COLOR_BUFFER_BIT);
+	uint drawnInputs = 0;
+	if (fullRedraw) {
+		resizeFramebufferCopy(&cache->frame, windowWidth, windowHeight);
+		drawnInputs = renderInputList(layout, config.imageWidth, config.imageHeight);
+		copyFramebuffer(&cache->frame);
+		cache->valid = true;
+	}
+	else if (newInputCount > 0) {
+		// Scroll the old inputs back by one slot and draw the new group in the space left at the front
+		if (horizontal) renderFramebufferCopy(cache->frame, -int(config.imageWidth), 0);
+		else renderFramebufferCopy(cache->frame, 0, -int(config.imageHeight));
+		drawnInputs = renderInputLayout(layout, newInputCount, config.imageWidth, config.imageHeight);
+		copyFramebuffer(&cache->frame);
+	}
+	else {
+		renderFramebufferCopy(cache->frame, 0, 0);
+	}
+	cache->renderedInsertCount = list.insertCount;
+	cache->renderedInputCount = list.inputs.size();
+	cache->renderedTextureVersion = layout.textureVersion;
+	return drawnInputs;
+}
+
+// Remove the oldest input from the list
+void dropLastInput(InputDisplayList* mod, TextureCache* textures)
+{
+	// Its group goes with it if it was the only input in it
+	uint last = mod->inputs.size()-1;
+	if (last == 0 || mod->inputs[last-1].frameNumber != mod->inputs[last].frameNumber) {
+		--mod->groupCount;
+	}
+	releaseTexture(textures, mod->inputs[last].image);
+	mod->inputs.pop_back();
+}
+
+void addInputToList(InputDisplayList* mod, TextureCache* textures, uint inputImage, uint frameNumber, uint64 inputTime, uint maxInputCount)
+{
+	TRACE_SCOPE("addInputToList");
+	InputDisplay display ={0};
+	display.image = inputImage;
+	display.frameNumber = frameNumber;
+	display.inputTime = inputTime;
+
+	if (mod->inputs.size() == 0 || mod->inputs[0].frameNumber != frameNumber) {
+		++mod->groupCount;
+	}
+	// The list holds a reference to each image in it, so reloading the config can't delete images that are still shown
+	retainTexture(textures, inputImage);
+	while (mod->inputs.size() && mod->inputs.size() >= maxInputCount) {
+		dropLastInput(mod, textures);
+	}
+	// Allocate the whole list up front, so adding inputs never allocates once the program is running
+	if (mod->inputs.capacity() < maxInputCount) {
+		mod->inputs.reserve(maxInputCount);
+	}
+	mod->inputs.resize(mod->inputs.size()+1);
+	++mod->insertCount;
+
+	// Shift all inputs in list back
+	uint i = mod->inputs.size()-1;
+	while (i>0) {
+		mod->inputs[i] = mod->inputs[i-1];
+		--i;
+	}
+
+	// Add input at front of list
+	mod->inputs[0] = display;
+}
+
+// The inputs pressed on one frame, found before they're added to a list.
+// Finding them only reads the input and configs, so separate players' inputs can be found on separate threads.
+struct FrameInputs
+{
+	static const uint maxInputs = 128;
+	// TextureCache ids, in the order they're added to the list. Any past maxInputs are left out.
+	uint images[maxInputs];
+	uint count;
+	// Directions held on all the joysticks looked at, combined to support combinations like up-left
+	uint direction;
+	// The profile of the last joystick that held a direction, whose direction mappings are used
+	const Config* directionProfile;
+};
+
+void addFrameInput(FrameInputs* mod, uint image)
+{
+	if (mod->count < FrameInputs::maxInputs) mod->images[mod->count++] = image;
+}
+
+// A joystick uses its own profile's mappings if one lists it, otherwise the active profile's
+const Config& getJoystickProfile(const Input::Joystick& joystick, const Config& activeProfile)
+{
+	return joystick.profile ? *joystick.profile : activeProfile;
+}
+
+// Find the mappings that a joystick started pressing this frame, and combine the directions it's holding
+void findJoystickInputs(FrameInputs* mod, const Input::Joystick& joystick, const Config& activeProfile)
+{
+	const Config* profile = &getJoystickProfile(joystick, activeProfile);
+	forloop(mapIndex, profile->inputMaps.size())
+	{
+		InputMapping map = profile->inputMaps[mapIndex];
+		if (checkInputAction(joystick.current, map.input))
+		{
+			if (map.result.type == InputResult::Type_direction) {
+				mod->direction |= map.result.direction;
+				mod->directionProfile = profile;
+			}
+			else if (!checkInputAction(joystick.previous, map.input)) {
+				// Only add if it was not active on the last frame
+				addFrameInput(mod, profile->images[map.result.image]);
+			}
+		}
+	}
+}
+
+// Add the image for the combined direction, if it changed since the last frame
+void findDirectionInput(FrameInputs* mod, uint previousDirectionInput)
+{
+	if (mod->direction == previousDirectionInput) return;
+	forloop(i, mod->directionProfile->directionMaps.size())
+	{
+		const DirectionMapping& map = mod->directionProfile->directionMaps[i];
+		if (map.direction == mod->direction) {
+			addFrameInput(mod, mod->directionProfile->images[map.image]);
+		}
+	}
+}
+
+// Feed a player's direction change and button presses to their profile's motion recognizer, adding the image
+// of any motion they complete. Directions go first, so a motion ending in a button can be finished on the same frame.
+void findMotionInputs(FrameInputs* mod, MotionState* state, const Config& profile, const Input& input, uint firstJoystick, uint joystickEnd, uint previousDirectionInput, uint frameNumber)
+{
+	const MotionRecognizer& recognizer = profile.motionRecognizer;
+	if (recognizer.matches.empty()) return;
+	const MotionMatch* match;
+	if (mod->direction != previousDirectionInput) {
+		match = feedMotionInput(state, recognizer, getDirectionSymbol(mod->direction), frameNumber);
+		if (match) addFrameInput(mod, profile.images[match->image]);
+	}
+	for (uint joystickIndex=firstJoystick; joystickIndex<joystickEnd; ++joystickIndex) {
+		const Input::Joystick& joystick = input.joysticks[joystickIndex];
+		forloop(button, Input::Joystick::State::buttonCount)
+		{
+			if (!joystick.current.buttons[button] || joystick.previous.buttons[button]) continue;
+			match = feedMotionInput(state, recognizer, getButtonSymbol(button), frameNumber);
+			if (match) addFrameInput(mod, profile.images[match->image]);
+		}
+	}
+}
+
+// directionProfile is used for the center image when no direction is held, so it should be the profile
+// of the joysticks being looked at, not the active one
+void startFrameInputs(FrameInputs* out, const Config& directionProfile)
+{
+	out->count = 0;
+	out->direction = 0;
+	out->directionProfile = &directionProfile;
+}
+
+// Add the inputs found for a frame to a list. Changes the texture cache, so it's only done on the main thread.
+void addFrameInputs(InputDisplayList* list, const FrameInputs& inputs, TextureCache* textures, JobQueue* jobs, uint frameNumber, uint64 inputTime, uint maxInputCount)
+{
+	forloop(i, inputs.count)
+	{
+		requestTexture(textures, jobs, inputs.images[i]);
+		addInputToList(list, textures, inputs.images[i], frameNumber, inputTime, maxInputCount);
+	}
+}
+
+// Add the inputs pressed since the last frame to the list, from every joystick.
+// Directions are combined across joysticks before deciding on which image to display.
+void recordInputs(InputDisplayList* list, uint* previousDirectionInput, const Input& input, const Config& activeProfile, TextureCache* textures, JobQueue* jobs, uint frameNumber)
+{
+	TRACE_SCOPE("recordInputs");
+	FrameInputs inputs;
+	startFrameInputs(&inputs, input.joystickCount ? getJoystickProfile(input.joysticks[0], activeProfile) : activeProfile);
+	forloop(joystickIndex, input.joystickCount)
+	{
+		findJoystickInputs(&inputs, input.joysticks[joystickIndex], activeProfile);
+	}
+	findDirectionInput(&inputs, *previousDirectionInput);
+	*previousDirectionInput = inputs.direction;
+	addFrameInputs(list, inputs, textures, jobs, frameNumber, input.pollTime, activeProfile.maxDisplayedInputs);
+}
+
+// One player's list, for showing each joystick's inputs separately. Each window showing it has its own layout.
+struct PlayerInputs
+{
+	static const uint maxPlayers = 8;
+	InputDisplayList list;
+	uint previousDirectionInput;
+	MotionState motion;
+};
+
+// The player a joystick's inputs go to. Joysticks past the last player share the last player's list.
+uint getJoystickPlayer(uint joystickIndex, uint playerCount)
+{
+	return std::min(joystickIndex, playerCount-1);
+}
+
+// The part of the window a player's list is drawn in, with the origin at the bottom left.
+// Lists are stacked across the direction they run in: a wide window is split into rows with the first
+// player on top, and a tall window into columns with the first player on the left.
+struct PlayerArea
+{
+	int x, y, width, height;
+};
+
+PlayerArea getPlayerArea(uint player, uint playerCount, int windowWidth, int windowHeight)
+{
+	PlayerArea area;
+	if (windowWidth > windowHeight) {
+		int top = windowHeight - windowHeight*(int)player/(int)playerCount;
+		int bottom = windowHeight - windowHeight*(int)(player+1)/(int)playerCount;
+		area.x = 0;
+		area.y = bottom;
+		area.width = windowWidth;
+		area.height = top - bottom;
+	}
+	else {
+		int left = windowWidth*(int)player/(int)playerCount;
+		int right = windowWidth*(int)(player+1)/(int)playerCount;
+		area.x = left;
+		area.y = 0;
+		area.width = right - left;
+		area.height = windowHeight;
+	}
+	return area;
+}
+
+// Add the inputs pressed since the last frame to each player's list, from their own joysticks only,
+// so one player's directions can't combine with another's.
+void recordPlayerInputs(PlayerInputs* players, uint playerCount, const Input& input, const Config& activeProfile, TextureCache* textures, JobQueue* jobs, uint frameNumber)
+{
+	TRACE_SCOPE("recordPlayerInputs");
+	FrameInputs inputs[PlayerInputs::maxPlayers];
+	playerCount = std::min(playerCount, (uint)PlayerInputs::maxPlayers);
+	// Each player only touches its own FrameInputs and MotionState here, so this loop could be split across threads.
+	// With a handful of joysticks it takes microseconds, less than handing it to other threads would.
+	forloop(player, playerCount)
+	{
+		// Motions and the center image use the profile of the player's first joystick
+		const Config& playerProfile = player < input.joystickCount ? getJoystickProfile(input.joysticks[player], activeProfile) : activeProfile;
+		startFrameInputs(&inputs[player], playerProfile);
+		uint joystickEnd = player;
+		while (joystickEnd < input.joystickCount && getJoystickPlayer(joystickEnd, playerCount) == player) {
+			findJoystickInputs(&inputs[player], input.joysticks[joystickEnd], activeProfile);
+			++joystickEnd;
+		}
+		findDirectionInput(&inputs[player], players[player].previousDirectionInput);
+		if (joystickEnd > player) {
+			findMotionInputs(&inputs[player], &players[player].motion, playerProfile, input, player, joystickEnd, players[player].previousDirectionInput, frameNumber);
+		}
+	}
+	forloop(player, playerCount)
+	{
+		players[player].previousDirectionInput = inputs[player].direction;
+		addFrameInputs(&players[player].list, inputs[player], textures, jobs, frameNumber, input.pollTime, activeProfile.maxDisplayedInputs);
+	}
+}
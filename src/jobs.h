@@ -0,0 +1,84 @@
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+
+// Worker threads that run jobs in the background.
+// Jobs must not call OpenGL, since the context is only current on the main thread.
+struct JobQueue
+{
+	std::mutex mutex;
+	// Signalled when a job is added or the workers should quit
+	std::condition_variable jobAdded;
+	// Signalled when the last outstanding job finishes
+	std::condition_variable jobsFinished;
+	std::deque<std::function<void()>> jobs;
+	std::vector<std::thread> workers;
+	uint unfinishedJobCount;
+	bool quit;
+};
+
+void runJobs(JobQueue* queue)
+{
+	std::unique_lock<std::mutex> lock(queue->mutex);
+	while (true) {
+		queue->jobAdded.wait(lock, [queue]{ return queue->quit || !queue->jobs.empty(); });
+		if (queue->jobs.empty()) return;
+		std::function<void()> job = queue->jobs.front();
+		queue->jobs.pop_front();
+		lock.unlock();
+		{
+			TRACE_SCOPE("job");
+			job();
+		}
+		lock.lock();
+		--queue->unfinishedJobCount;
+		if (queue->unfinishedJobCount == 0) {
+			queue->jobsFinished.notify_all();
+		}
+	}
+}
+
+// Starts one worker per hardware thread
+void startJobQueue(JobQueue* out)
+{
+	out->unfinishedJobCount = 0;
+	out->quit = false;
+	uint workerCount = std::thread::hardware_concurrency();
+	if (workerCount == 0) workerCount = 1;
+	forloop(i, workerCount)
+	{
+		out->workers.push_back(std::thread(runJobs, out));
+	}
+}
+
+void addJob(JobQueue* mod, std::function<void()> job)
+{
+	std::lock_guard<std::mutex> lock(mod->mutex);
+	mod->jobs.push_back(job);
+	++mod->unfinishedJobCount;
+	mod->jobAdded.notify_one();
+}
+
+// Block until every job added so far has finished
+void waitForJobs(JobQueue* mod)
+{
+	std::unique_lock<std::mutex> lock(mod->mutex);
+	mod->jobsFinished.wait(lock, [mod]{ return mod->unfinishedJobCount == 0; });
+}
+
+// Finishes the queued jobs, then joins the workers
+void stopJobQueue(JobQueue* mod)
+{
+	{
+		std::lock_guard<std::mutex> lock(mod->mutex);
+		mod->quit = true;
+		mod->jobAdded.notify_all();
+	}
+	forloop(i, mod->workers.size())
+	{
+		mod->workers[i].join();
+	}
+	mod->workers.clear();
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+// Measures input to photon latency: the time from reading an input to presenting the first frame that shows it.
+// Latencies go in a histogram with buckets that grow with the value, like HdrHistogram, so percentiles
+// are accurate to within about 6% from a microsecond up to hours, in a fixed amount of memory.
+struct LatencyHistogram
+{
+	// Values below 32 get a bucket each. Above that, each power of two is split into 16 buckets.
+	static const uint subBucketBits = 4;
+	static const uint subBucketCount = 1 << subBucketBits;
+	static const uint bucketCount = (64 - subBucketBits) * subBucketCount + 2*subBucketCount;
+	uint64 counts[bucketCount];
+	uint64 total;
+	uint64 max;
+	uint64 last;
+};
+
+uint latencyBucket(uint64 microseconds)
+{
+	if (microseconds < 2*LatencyHistogram::subBucketCount) return (uint)microseconds;
+	uint highestBit = 63;
+	while (!(microseconds >> highestBit)) --highestBit;
+	uint shift = highestBit - LatencyHistogram::subBucketBits;
+	return shift*LatencyHistogram::subBucketCount + (uint)(microseconds >> shift);
+}
+
+// The largest value that goes in a bucket
+uint64 latencyBucketValue(uint bucket)
+{
+	if (bucket < 2*LatencyHistogram::subBucketCount) return bucket;
+	uint shift = bucket/LatencyHistogram::subBucketCount - 1;
+	uint64 top = bucket - shift*LatencyHistogram::subBucketCount;
+	return ((top+1) << shift) - 1;
+}
+
+void recordLatency(LatencyHistogram* mod, uint64 microseconds)
+{
+	++mod->counts[latencyBucket(microseconds)];
+	++mod->total;
+	if (microseconds > mod->max) mod->max = microseconds;
+	mod->last = microseconds;
+}
+
+// The latency that the given fraction of inputs were at or under
+uint64 latencyPercentile(const LatencyHistogram& histogram, double fraction)
+{
+	if (!histogram.total) return 0;
+	uint64 target = (uint64)(fraction * histogram.total + 0.5);
+	if (target < 1) target = 1;
+	uint64 seen = 0;
+	forloop(i, LatencyHistogram::bucketCount)
+	{
+		seen += histogram.counts[i];
+		if (seen >= target) return std::min(latencyBucketValue(i), histogram.max);
+	}
+	return histogram.max;
+}
+
+void formatLatencySummary(const LatencyHistogram& histogram, char* out, size_t size)
+{
+	snprintf(out, size, "latency p50 %.1f ms, p99 %.1f ms, max %.1f ms (%llu inputs)",
+		latencyPercentile(histogram, 0.5) / 1000.0, latencyPercentile(histogram, 0.99) / 1000.0,
+		histogram.max / 1000.0, histogram.total);
+}
+
+// Write the non-empty buckets as CSV, one line per bucket, for graphing
+bool saveLatencyHistogram(const LatencyHistogram& histogram, const char* filePath)
+{
+	FILE* file = fopen(filePath, "w");
+	if (!file) return false;
+	fprintf(file, "max_microseconds,count\n");
+	forloop(i, LatencyHistogram::bucketCount)
+	{
+		if (histogram.counts[i]) fprintf(file, "%llu,%llu\n", latencyBucketValue(i), histogram.counts[i]);
+	}
+	bool written = !ferror(file);
+	fclose(file);
+	return written;
+}
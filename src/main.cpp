@@ -1,395 +1,542 @@
 #include "platform.h"
 #include "graphics.h"
+#include <cstdio>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <string>
 #include <vector>
-
-struct ButtonInputAction
-{
-	uint buttonIndex;
-};
-
-// D-pads are sometimes mapped to 8-way HAT inputs
-struct HatInputAction
-{
-	uint pov;
-};
-
-struct AxisInputAction
-{
-	uint axisIndex;
-	float restPosition;
-	float triggerPosition;
-};
-
-struct KeyboardInputAction
-{
-	uint keyIndex;
-};
-
-struct InputAction
-{
-	enum Type { Type_button, Type_hat, Type_axis, Type_keyboard };
-
-	union {
-		ButtonInputAction button;
-		HatInputAction hat;
-		AxisInputAction axis;
-		KeyboardInputAction key;
-	};
-
-	Type type;
-};
-
-struct InputResult
-{
-	enum Type { Type_direction, Type_image };
-	union {
-		Texture image;
-		uint direction;
-	};
-	Type type;
-};
-
-struct InputMapping
-{
-	InputResult result;
-	InputAction input;
-};
-
-struct DirectionMapping
+#include "allocations.h"
+#include "trace.h"
+#include "latency.h"
+#include "jobs.h"
+#include "imagecache.h"
+#include "textures.h"
+#include "motion.h"
+#include "config.h"
+#include "bundle.h"
+#include "reload.h"
+#include "control.h"
+#include "inputlist.h"
+#include "hud.h"
+#include "publish.h"
+#include "stream.h"
+#include "inject.h"
+
+struct RenderStats
 {
-	uint direction;
-	Texture image;
+	uint drawnInputs;
+	uint storedInputs;
+	// Number of latencies measured, so the title is only updated when there's a new one
+	uint64 latencyCount;
+	// Heap allocations the main thread made during the last whole frame
+	uint64 frameAllocations;
 };
 
-struct Config
+// A window asked for with --window
+struct WindowOptions
 {
-	Color backgroundColor;
-	bool alwaysOnTop;
-	bool transparentBackground;
-	uint imageWidth;
-	uint imageHeight;
-	uint maxDisplayedInputs;
-	std::vector<InputMapping> inputMaps;
-	std::vector<DirectionMapping> directionMaps;
+	int width;
+	int height;
+	// The player whose list the window shows, from 1, or 0 to show every player's
+	uint player;
 };
 
-struct InputDisplay
+struct CommandLine
 {
-	Texture image;
-	uint frameNumber;
+	static const uint maxWindows = 4;
+	const char* configPath;
+	bool renderCache;
+	bool stats;
+	bool lazyImages;
+	bool watch;
+	const char* imageCachePath;
+	// Bake configPath into this bundle file and exit instead of running
+	const char* bakePath;
+	// Profile to start with, instead of the first one in the config
+	const char* profileName;
+	// Local port for the control server, or 0 to not run it
+	uint controlPort;
+	// Record how long each part of a frame takes, and save it here on exit or SIGUSR1
+	const char* tracePath;
+	// Measure input to photon latency, and save the histogram here on exit
+	const char* latencyPath;
+	// Show the performance HUD from the start
+	bool hud;
+	// Publish the input list in shared memory with this name
+	const char* sharedMemoryName;
+	// Stream input events and list changes to clients connecting to this local port or Unix domain socket
+	uint eventPort;
+	const char* eventSocketPath;
+	// Take joystick input from a program connecting to this local port or Unix domain socket, instead of real joysticks
+	uint injectPort;
+	const char* injectSocketPath;
+	// Number of separate input lists. Joystick n goes to player n, and any past the last player go to the last.
+	uint playerCount;
+	// Windows to open, all showing inputs from the same joysticks. With none given, one window opens at the default size.
+	WindowOptions windows[maxWindows];
+	uint windowCount;
 };
 
-struct InputDisplayList
+// What's drawn in one window, at the window's own size
+struct WindowView
 {
-	std::vector<InputDisplay> inputs;
+	uint player;
+	// The size the viewport was last set for
+	int width;
+	int height;
+	InputLayout layouts[PlayerInputs::maxPlayers];
+	RenderCache renderCache;
 };
 
-bool parseBool(std::istream& input)
+// Give each joystick the profile that lists its GUID or name. Joysticks without one use the active profile.
+void assignJoystickProfiles(Input* input, const ConfigSet& config, const JoystickProfileIndex& index)
 {
-	std::string lineBuffer;
-	std::getline(input, lineBuffer);
-	std::stringstream line(lineBuffer);
-	std::string value;
-	line >> value;
-	return (value == "true");
-}
-
-uint parseUInt(std::istream& input)
-{
-	std::string lineBuffer;
-	std::getline(input, lineBuffer);
-	std::stringstream line(lineBuffer);
-	uint result;
-	line >> result;
-	return result;
-}
-
-Color parseColor(std::istream& input)
-{
-	std::string lineBuffer;
-	std::getline(input, lineBuffer);
-	std::stringstream line(lineBuffer);
-	Color result;
-	line >> result.r >> result.g >> result.b;
-	return result;
-}
-
-InputResult parseInputResult(std::istream& line)
-{
-	InputResult result;
-	result.type = InputResult::Type_direction;
-	std::string text;
-	line >> text;
-	if      (text == "left")  result.direction = SDL_HAT_LEFT;
-	else if (text == "right") result.direction = SDL_HAT_RIGHT;
-	else if (text == "up")    result.direction = SDL_HAT_UP;
-	else if (text == "down")  result.direction = SDL_HAT_DOWN;
-	else {
-		result.type = InputResult::Type_image;
-		createTextureFromImage(&result.image, text.c_str());
+	forloop(i, input->joystickCount)
+	{
+		Input::Joystick* joystick = &input->joysticks[i];
+		joystick->profile = findJoystickProfile(config, index, joystick->guid, joystick->name);
 	}
-	return result;
 }
 
-DirectionMapping parseDirectionMapping(std::istream& line)
+void registerProfileHotkeys(Window* window, const ConfigSet& config)
 {
-	DirectionMapping result ={0};
-	std::string direction;
-	line >> direction;
-	if (direction == "left")           result.direction = SDL_HAT_LEFT;
-	else if (direction == "right")     result.direction = SDL_HAT_RIGHT;
-	else if (direction == "up")        result.direction = SDL_HAT_UP;
-	else if (direction == "down")      result.direction = SDL_HAT_DOWN;
-	else if (direction == "upleft")    result.direction = SDL_HAT_LEFTUP;
-	else if (direction == "downleft")  result.direction = SDL_HAT_LEFTDOWN;
-	else if (direction == "upright")   result.direction = SDL_HAT_RIGHTUP;
-	else if (direction == "downright") result.direction = SDL_HAT_RIGHTDOWN;
-	else if (direction == "center")    result.direction = SDL_HAT_CENTERED;
-	std::string file;
-	line >> file;
-	createTextureFromImage(&result.image, file.c_str());
-	return result;
+	std::vector<uint> keys;
+	forloop(i, config.profiles.size())
+	{
+		if (config.profiles[i].hotkey) keys.push_back(config.profiles[i].hotkey);
+	}
+	setHotkeys(window, keys.data(), keys.size());
 }
 
-InputMapping parseButtonMapping(std::istream& line)
+// Draw the lists a window shows, each in its own part of the window. Returns the number of inputs drawn.
+uint renderWindowView(WindowView* mod, const PlayerInputs* players, uint playerCount, const TextureCache& textures, const Config& config, bool useRenderCache)
 {
-	InputMapping result ={0};
-	result.input.type = InputAction::Type_button;
-	line >> result.input.button.buttonIndex;
-	result.result = parseInputResult(line);
-	return result;
+	uint firstPlayer = mod->player ? mod->player-1 : 0;
+	uint shownCount = mod->player ? 1 : playerCount;
+	// The render cache copies the whole window, so it's only used for a single list
+	if (useRenderCache && shownCount == 1) {
+		InputLayout* layout = &mod->layouts[firstPlayer];
+		updateInputLayout(layout, players[firstPlayer].list, textures, config.imageWidth, config.imageHeight, mod->width, mod->height);
+		return renderCachedInputList(&mod->renderCache, players[firstPlayer].list, *layout, config, mod->width, mod->height);
+	}
+	glClearColor(config.backgroundColor.r, config.backgroundColor.g, config.backgroundColor.b, 0);
+	glClear(GL_COLOR_BUFFER_BIT);
+	uint drawnInputs = 0;
+	forloop(i, shownCount)
+	{
+		uint player = firstPlayer + i;
+		PlayerArea area = getPlayerArea(i, shownCount, mod->width, mod->height);
+		if (shownCount > 1) setViewportArea(area.x, area.y, area.width, area.height);
+		updateInputLayout(&mod->layouts[player], players[player].list, textures, config.imageWidth, config.imageHeight, area.width, area.height);
+		drawnInputs += renderInputList(mod->layouts[player], config.imageWidth, config.imageHeight);
+	}
+	if (shownCount > 1) setViewport(mod->width, mod->height);
+	return drawnInputs;
 }
 
-InputMapping parseHatMapping(std::istream& line)
+// Lay out and draw everything again, after the profile or images changed
+void invalidateWindowViews(std::vector<WindowView>* views)
 {
-	InputMapping result ={0};
-	result.input.type = InputAction::Type_hat;
-	std::string direction;
-	line >> direction;
-	if (direction == "left")       result.input.hat.pov = SDL_HAT_LEFT;
-	else if (direction == "right") result.input.hat.pov = SDL_HAT_RIGHT;
-	else if (direction == "up")    result.input.hat.pov = SDL_HAT_UP;
-	else if (direction == "down")  result.input.hat.pov = SDL_HAT_DOWN;
-	result.result = parseInputResult(line);
-	return result;
+	forloop(i, views->size())
+	{
+		forloop(player, PlayerInputs::maxPlayers)
+		{
+			(*views)[i].layouts[player].valid = false;
+		}
+		(*views)[i].renderCache.valid = false;
+	}
 }
 
-InputMapping parseAxisMapping(std::istream& line)
+// Options start with "--". Any other argument is the config file to load.
+CommandLine parseCommandLine(int argc, char** argv)
 {
-	InputMapping result ={0};
-	result.input.type = InputAction::Type_axis;
-	line >> result.input.axis.axisIndex;
-	line >> result.input.axis.restPosition;
-	line >> result.input.axis.triggerPosition;
-	result.result = parseInputResult(line);
+	CommandLine result ={0};
+	result.configPath = "config.txt";
+	result.playerCount = 1;
+	for (int i=1; i<argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--render-cache") result.renderCache = true;
+		else if (arg == "--stats") result.stats = true;
+		else if (arg == "--lazy-images") result.lazyImages = true;
+		else if (arg == "--watch") result.watch = true;
+		else if (arg == "--image-cache" && i+1 < argc) result.imageCachePath = argv[++i];
+		else if (arg == "--bake" && i+1 < argc) result.bakePath = argv[++i];
+		else if (arg == "--profile" && i+1 < argc) result.profileName = argv[++i];
+		else if (arg == "--control-port" && i+1 < argc) result.controlPort = (uint)atoi(argv[++i]);
+		else if (arg == "--trace" && i+1 < argc) result.tracePath = argv[++i];
+		else if (arg == "--latency" && i+1 < argc) result.latencyPath = argv[++i];
+		else if (arg == "--hud") result.hud = true;
+		else if (arg == "--shared-memory" && i+1 < argc) result.sharedMemoryName = argv[++i];
+		else if (arg == "--event-port" && i+1 < argc) result.eventPort = (uint)atoi(argv[++i]);
+		else if (arg == "--event-socket" && i+1 < argc) result.eventSocketPath = argv[++i];
+		else if (arg == "--inject-port" && i+1 < argc) result.injectPort = (uint)atoi(argv[++i]);
+		else if (arg == "--inject-socket" && i+1 < argc) result.injectSocketPath = argv[++i];
+		else if (arg == "--players" && i+1 < argc) result.playerCount = (uint)atoi(argv[++i]);
+		else if (arg == "--window" && i+1 < argc) {
+			WindowOptions window ={0};
+			const char* size = argv[++i];
+			if (sscanf(size, "%dx%d:%u", &window.width, &window.height, &window.player) >= 2 && window.width > 0 && window.height > 0) {
+				if (result.windowCount < CommandLine::maxWindows) result.windows[result.windowCount++] = window;
+			}
+			else {
+				fprintf(stderr, "--window %s should be a size like 600x100, optionally followed by :player\n", size);
+			}
+		}
+		else result.configPath = argv[i];
+	}
+	result.playerCount = std::max(1u, std::min(result.playerCount, (uint)PlayerInputs::maxPlayers));
+	if (result.windowCount == 0) {
+		result.windows[0].width = 600;
+		result.windows[0].height = 100;
+		result.windowCount = 1;
+	}
+	forloop(i, result.windowCount)
+	{
+		if (result.windows[i].player > result.playerCount) {
+			fprintf(stderr, "there's no player %u, so the window shows every player\n", result.windows[i].player);
+			result.windows[i].player = 0;
+		}
+	}
 	return result;
 }
 
-void parseConfigFile(Config* out, const char* filePath)
+// Load either a config file or a baked bundle. Errors in either are shown in a message box.
+void loadConfig(ConfigSet* out, TextureCache* textures, JobQueue* jobs, const char* filePath)
 {
-	std::ifstream inputFile(filePath);
-	// Each of these reads a line and takes the first word as the value
-	out->alwaysOnTop = parseBool(inputFile);
-	out->transparentBackground = parseBool(inputFile);
-	out->backgroundColor = parseColor(inputFile);
-	out->imageWidth = parseUInt(inputFile);
-	out->imageHeight = parseUInt(inputFile);
-	out->maxDisplayedInputs = parseUInt(inputFile);
-
-	// Parse direction and input mappings
-	while (!inputFile.eof()) {
-		std::string lineBuffer;
-		std::getline(inputFile, lineBuffer);
-		std::stringstream line(lineBuffer);
-		std::string inputType;
-		line >> inputType;
-		if (inputType == "d") out->directionMaps.push_back(parseDirectionMapping(line));
-		else if (inputType == "b") out->inputMaps.push_back(parseButtonMapping(line));
-		else if (inputType == "h") out->inputMaps.push_back(parseHatMapping(line));
-		else if (inputType == "a") out->inputMaps.push_back(parseAxisMapping(line));
+	if (isBundleFile(filePath)) {
+		// A bundle that can't be loaded isn't parsed as a config, which would only give a screen full of nonsense errors
+		std::string error;
+		if (!loadBundle(out, textures, filePath, &error)) {
+			std::string message = std::string(filePath) + ": " + error + "\n";
+			fprintf(stderr, "%s", message.c_str());
+			SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_WARNING, "Bundle error", message.c_str(), 0);
+		}
+		return;
 	}
+	std::vector<ConfigError> errors;
+	parseConfigFile(out, filePath, &errors);
+	if (errors.size()) {
+		std::string message = formatConfigErrors(filePath, errors);
+		fprintf(stderr, "%s", message.c_str());
+		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_WARNING, "Config errors", message.c_str(), 0);
+	}
+	loadConfigImages(out, textures, jobs);
 }
 
-// Check if an input is currently active
-bool checkInputAction(Input::Joystick::State joystick, InputAction action)
+int main(int argc, char** argv)
 {
-	if (action.type == InputAction::Type_button
-		&& action.button.buttonIndex < joystick.buttonCount
-		&& joystick.buttons[action.button.buttonIndex])
-	{
-		return true;
+	CommandLine commandLine = parseCommandLine(argc, argv);
+	if (commandLine.bakePath) {
+		JobQueue jobs;
+		startJobQueue(&jobs);
+		bool baked = bakeBundle(commandLine.configPath, commandLine.bakePath, &jobs);
+		stopJobQueue(&jobs);
+		return baked ? 0 : 1;
 	}
 
-	if (action.type == InputAction::Type_hat
-		&& joystick.hat & action.hat.pov)
-	{
-		return true;
+	// Injected input replaces the joysticks, so they aren't opened at all
+	bool injectInput = commandLine.injectPort || commandLine.injectSocketPath;
+	SDL_Init(SDL_INIT_VIDEO);
+	if (!injectInput) {
+		SDL_InitSubSystem(SDL_INIT_JOYSTICK);
+		SDL_SetHint(SDL_HINT_JOYSTICK_ALLOW_BACKGROUND_EVENTS, "1");
 	}
 
-	if (action.type == InputAction::Type_axis
-		&& action.axis.axisIndex < joystick.axisCount)
+	// Every window draws with the first one's OpenGL context, so they all share one set of textures
+	std::vector<Window> windows(commandLine.windowCount, Window());
+	std::vector<WindowView> views(commandLine.windowCount, WindowView());
+	forloop(i, windows.size())
 	{
-		float axisCurrent = joystick.axes[action.axis.axisIndex];
-		if (action.axis.triggerPosition < action.axis.restPosition
-			&& axisCurrent <= action.axis.triggerPosition)
-		{
-			return true;
-		}
-		if (action.axis.triggerPosition > action.axis.restPosition
-			&& axisCurrent >= action.axis.triggerPosition)
-		{
-			return true;
-		}
+		createWindow(&windows[i], commandLine.windows[i].width, commandLine.windows[i].height, i ? &windows[0] : 0);
+		views[i].player = commandLine.windows[i].player;
 	}
+	makeWindowCurrent(&windows[0]);
+	setupOpenGL();
 
-	return false;
-}
+	JobQueue jobs;
+	startJobQueue(&jobs);
 
-void renderInputList(InputDisplayList list, uint imageWidth, uint imageHeight, int windowWidth, int windowHeight)
-{
-	float renderHeight = 2*float(imageHeight)/float(windowHeight);
-	float renderWidth = 2*float(imageWidth)/float(windowWidth);
-	if (windowWidth > windowHeight) {
-		// Display list horizontally
-		float x = 2-renderWidth;
-		float y = 0;
-		forloop(i, list.inputs.size())
-		{
-			renderImage(list.inputs[i].image, x, y, renderWidth, renderHeight);
-			// Overlap inputs that happened on the same frame
-			if (i<list.inputs.size()-1 && list.inputs[i].frameNumber == list.inputs[i+1].frameNumber) {
-				y += renderHeight*0.6f;
-			}
-			else {
-				x -= renderWidth;
-				y = 0;
-			}
-		}
+	TextureCache textures;
+	if (commandLine.tracePath) startTracing();
+	if (commandLine.imageCachePath) textures.diskCachePath = commandLine.imageCachePath;
+	if (commandLine.lazyImages) {
+		textures.loadOnRequest = true;
+		createPlaceholderTexture(&textures);
 	}
-	else {
-		// Display list vertically
-		float x = 0;
-		float y = 2 - renderHeight;
-		forloop(i, list.inputs.size())
-		{
-			renderImage(list.inputs[i].image, x, y, renderWidth, renderHeight);
-			// Overlap inputs that happened on the same frame
-			if (i<list.inputs.size()-1 && list.inputs[i].frameNumber == list.inputs[i+1].frameNumber) {
-				x += renderWidth*0.6f;
-			}
-			else {
-				y -= renderHeight;
-				x = 0;
-			}
+	ConfigSet configs;
+	loadConfig(&configs, &textures, &jobs, commandLine.configPath);
+	if (configs.profiles.empty()) {
+		configs.profiles.push_back(Config());
+	}
+	int activeProfile = 0;
+	if (commandLine.profileName) {
+		activeProfile = findProfile(configs, commandLine.profileName);
+		if (activeProfile < 0) {
+			fprintf(stderr, "%s: there's no profile called %s\n", commandLine.configPath, commandLine.profileName);
+			activeProfile = 0;
 		}
 	}
-}
-
-void addInputToList(InputDisplayList* mod, Texture inputImage, uint frameNumber, uint maxInputCount)
-{
-	InputDisplay display ={0};
-	display.image = inputImage;
-	display.frameNumber = frameNumber;
+	Config* config = &configs.profiles[activeProfile];
+	std::string activeProfileName = config->name;
 
-	if (mod->inputs.size() < maxInputCount) {
-		mod->inputs.resize(mod->inputs.size()+1);
+	forloop(i, windows.size())
+	{
+		setWindowStyle(&windows[i], config->alwaysOnTop, config->transparentBackground);
 	}
+	registerProfileHotkeys(&windows[0], configs);
 
-	// Shift all inputs in list back
-	uint i = mod->inputs.size()-1;
-	while (i>0) {
-		mod->inputs[i] = mod->inputs[i-1];
-		--i;
+	ControlServer controlServer;
+	if (commandLine.controlPort && !startControlServer(&controlServer, commandLine.controlPort)) {
+		fprintf(stderr, "couldn't listen on port %u for control connections\n", commandLine.controlPort);
 	}
 
-	// Add input at front of list
-	mod->inputs[0] = display;
-}
+	SharedListPublisher publisher;
+	if (commandLine.sharedMemoryName && !startSharedListPublisher(&publisher, commandLine.sharedMemoryName)) {
+		fprintf(stderr, "couldn't create shared memory called %s\n", commandLine.sharedMemoryName);
+		commandLine.sharedMemoryName = 0;
+	}
 
-int main(int argc, char** argv)
-{
-	SDL_Init(SDL_INIT_VIDEO);
-	SDL_InitSubSystem(SDL_INIT_JOYSTICK);
-	SDL_SetHint(SDL_HINT_JOYSTICK_ALLOW_BACKGROUND_EVENTS, "1");
+	EventStreamServer eventServer;
+	bool streamEvents = commandLine.eventPort || commandLine.eventSocketPath;
+	if (streamEvents && !startEventStreamServer(&eventServer, commandLine.eventPort, commandLine.eventSocketPath)) {
+		fprintf(stderr, "couldn't listen for event stream connections\n");
+		stopEventStreamServer(&eventServer);
+		streamEvents = false;
+	}
 
-	Window window ={0};
-	createWindow(&window);
-	setupOpenGL();
-	
-	Config config ={0};
-	if (argc > 1) parseConfigFile(&config, argv[1]);
-	else parseConfigFile(&config, "config.txt");
+	InjectionServer injection;
+	if (injectInput && !startInjectionServer(&injection, commandLine.injectPort, commandLine.injectSocketPath)) {
+		fprintf(stderr, "couldn't listen for injected input connections\n");
+	}
 
-	setWindowStyle(&window, config.alwaysOnTop, config.transparentBackground);
+	// Bundles are meant to be deployed as they are, so only config files are watched
+	HotReload hotReload;
+	bool watch = commandLine.watch && !isBundleFile(commandLine.configPath);
+	if (watch) {
+		startHotReload(&hotReload, commandLine.configPath, configs, textures);
+	}
 
+	JoystickProfileIndex joystickProfiles;
+	indexJoystickProfiles(configs, &joystickProfiles);
 	Input input = {0};
-	updateInput(&input);
-	InputDisplayList inputList;
+	if (!injectInput) updateInput(&input);
+	assignJoystickProfiles(&input, configs, joystickProfiles);
+	std::vector<PlayerInputs> players(commandLine.playerCount, PlayerInputs());
+	RenderStats renderStats ={0};
+	RenderStats displayedStats ={0};
+	LatencyHistogram latency ={0};
+	PerformanceHud hud;
+	createHud(&hud);
+	hud.visible = commandLine.hud;
+	uint presentedInsertCounts[PlayerInputs::maxPlayers] ={0};
 
 	uint frameCount = 0;
-	uint previousDirectionInput = 0;
-	int previousWindowWidth = 0;
-	int previousWindowHeight = 0;
+	int requestedProfile = -1;
 	bool run = true;
 	while (run) {
-		bool quit;
-		processWindowMessages(&window, &quit);
-		if (quit) run = false;
-
-		// Resize viewport if window size changed
-		int windowWidth, windowHeight;
-		getWindowSize(window, &windowWidth, &windowHeight);
-		if (previousWindowWidth != windowWidth|| previousWindowHeight != windowHeight) {
-			glViewport(0, 0, windowWidth, windowHeight);
-			previousWindowWidth = windowWidth;
-			previousWindowHeight = windowHeight;
+		TRACE_SCOPE("frame");
+		uint64 frameStartAllocations = getThreadAllocationCount();
+		drawCallCount = 0;
+		WindowMessages messages;
+		{
+			TRACE_SCOPE("processWindowMessages");
+			processWindowMessages(windows.data(), windows.size(), &messages);
 		}
+		if (messages.quit) run = false;
 
-		// Record inputs
-		// Directions are combined to support combinations like up-left before deciding on which image to display
-		updateInput(&input);
-		uint accumulatedDirection = 0;
-		forloop(mapIndex, config.inputMaps.size())
+		// Profiles are switched by their hotkeys or the control server.
+		// The switch waits until the new profile's images are loaded, which only takes time with --lazy-images,
+		// then happens here between frames.
+		forloop(i, messages.pressedKeyCount)
 		{
-			InputMapping map = config.inputMaps[mapIndex];
-			forloop(joystickIndex, input.joystickCount)
-			{
-				Input::Joystick joystick = input.joysticks[joystickIndex];
-				if (checkInputAction(joystick.current, map.input))
-				{
-					if (map.result.type == InputResult::Type_direction) {
-						accumulatedDirection |= map.result.direction;
-					}
-					else if (!checkInputAction(joystick.previous, map.input)) {
-						// Only add if it was not active on the last frame
-						addInputToList(&inputList, map.result.image, frameCount, config.maxDisplayedInputs);
+			if (messages.pressedKeys[i] == hudKey) hud.visible = !hud.visible;
+			int profile = findProfileForHotkey(configs, messages.pressedKeys[i]);
+			if (profile >= 0) requestedProfile = profile;
+		}
+		if (commandLine.controlPort) {
+			int profile = pollControlServer(&controlServer, configs);
+			if (profile >= 0) requestedProfile = profile;
+		}
+		if (requestedProfile >= 0) {
+			requestProfileImages(configs.profiles[requestedProfile], &textures, &jobs);
+			if (profileImagesLoaded(configs.profiles[requestedProfile], textures)) {
+				if (requestedProfile != activeProfile) {
+					activeProfile = requestedProfile;
+					config = &configs.profiles[activeProfile];
+					activeProfileName = config->name;
+					forloop(i, windows.size())
+					{
+						setWindowStyle(&windows[i], config->alwaysOnTop, config->transparentBackground);
 					}
+					invalidateWindowViews(&views);
 				}
+				requestedProfile = -1;
 			}
 		}
-		if (accumulatedDirection != previousDirectionInput)
-		{
-			forloop(i, config.directionMaps.size())
-			{
-				if (config.directionMaps[i].direction == accumulatedDirection) {
-					addInputToList(&inputList, config.directionMaps[i].image, frameCount, config.maxDisplayedInputs);
+
+		// Record inputs. Injected input can have several of the game's frames arrive at once, and each is recorded with its own frame number.
+		if (injectInput) {
+			pollInjectionServer(&injection, &input);
+			uint gameFrame;
+			while (readInjectedFrame(&injection, &input, &gameFrame)) {
+				if (input.joysticksChanged) {
+					assignJoystickProfiles(&input, configs, joystickProfiles);
+				}
+				recordPlayerInputs(players.data(), players.size(), input, *config, &textures, &jobs, gameFrame);
+				if (streamEvents) {
+					streamInputChanges(&eventServer, input, gameFrame);
 				}
 			}
-			previousDirectionInput = accumulatedDirection;
+		}
+		else {
+			{
+				TRACE_SCOPE("updateInput");
+				updateInput(&input);
+			}
+			if (input.joysticksChanged) {
+				assignJoystickProfiles(&input, configs, joystickProfiles);
+			}
+			recordPlayerInputs(players.data(), players.size(), input, *config, &textures, &jobs, frameCount);
+			if (streamEvents) {
+				streamInputChanges(&eventServer, input, frameCount);
+			}
+		}
+		uint insertCount = 0;
+		forloop(player, players.size())
+		{
+			insertCount += players[player].list.insertCount;
+		}
+		updateHudRates(&hud, input, insertCount, getMicroseconds());
+		if (commandLine.sharedMemoryName) {
+			publishSharedList(&publisher, players.data(), players.size(), textures, frameCount);
+		}
+		if (streamEvents) {
+			pollEventStreamServer(&eventServer, players.data(), players.size(), textures, frameCount);
 		}
 
 		// Render
-		glClearColor(config.backgroundColor.r, config.backgroundColor.g, config.backgroundColor.b, 0);
-		glClear(GL_COLOR_BUFFER_BIT);
-		renderInputList(inputList, config.imageWidth, config.imageHeight, windowWidth, windowHeight);
-		
-		swapBuffers(&window);
+		uploadFinishedTextures(&textures);
+		if (watch && applyHotReload(&hotReload, &configs, &textures, &jobs)) {
+			// Stay on the same profile if it's still there
+			activeProfile = findProfile(configs, activeProfileName);
+			if (activeProfile < 0) activeProfile = 0;
+			if (configs.profiles.empty()) configs.profiles.push_back(Config());
+			config = &configs.profiles[activeProfile];
+			activeProfileName = config->name;
+			indexJoystickProfiles(configs, &joystickProfiles);
+			assignJoystickProfiles(&input, configs, joystickProfiles);
+			registerProfileHotkeys(&windows[0], configs);
+			requestedProfile = -1;
+			forloop(i, windows.size())
+			{
+				setWindowStyle(&windows[i], config->alwaysOnTop, config->transparentBackground);
+			}
+			invalidateWindowViews(&views);
+			// Motions in progress belong to the old config's automatons
+			forloop(player, players.size())
+			{
+				resetMotionState(&players[player].motion);
+			}
+		}
+		renderStats.drawnInputs = 0;
+		renderStats.storedInputs = 0;
+		forloop(player, players.size())
+		{
+			renderStats.storedInputs += players[player].list.inputs.size();
+		}
+		// The most inputs of each player's list shown in any window, for measuring latency
+		uint visibleInputs[PlayerInputs::maxPlayers] ={0};
+		forloop(windowIndex, windows.size())
+		{
+			WindowView* view = &views[windowIndex];
+			if (windows.size() > 1) makeWindowCurrent(&windows[windowIndex]);
+			// Resize viewport if window size changed. With several windows sharing a context, it's set for each one.
+			int windowWidth, windowHeight;
+			getWindowSize(windows[windowIndex], &windowWidth, &windowHeight);
+			if (windows.size() > 1 || view->width != windowWidth || view->height != windowHeight) {
+				setViewport(windowWidth, windowHeight);
+				view->width = windowWidth;
+				view->height = windowHeight;
+			}
+			renderStats.drawnInputs += renderWindowView(view, players.data(), players.size(), textures, *config, commandLine.renderCache);
+			uint viewVisibleInputs = 0;
+			forloop(player, players.size())
+			{
+				visibleInputs[player] = std::max(visibleInputs[player], (uint)view->layouts[player].quads.size());
+				viewVisibleInputs += view->layouts[player].quads.size();
+			}
+			// The HUD is only shown in the first window
+			if (hud.visible && windowIndex == 0) {
+				renderHud(hud, renderStats.storedInputs, viewVisibleInputs, textures, latency, windowHeight);
+			}
+			{
+				TRACE_SCOPE("swapBuffers");
+				swapBuffers(&windows[windowIndex]);
+			}
+		}
+		renderStats.latencyCount = latency.total;
+		if (commandLine.stats
+			&& (renderStats.drawnInputs != displayedStats.drawnInputs || renderStats.storedInputs != displayedStats.storedInputs
+				|| renderStats.latencyCount != displayedStats.latencyCount || renderStats.frameAllocations != displayedStats.frameAllocations))
+		{
+			char latencySummary[128];
+			formatLatencySummary(latency, latencySummary, sizeof(latencySummary));
+			char title[256];
+			snprintf(title, sizeof(title), "Input Display - drawn %u / stored %u - last %.1f ms, %s - %llu allocations", renderStats.drawnInputs, renderStats.storedInputs,
+				latency.last / 1000.0, latencySummary, renderStats.frameAllocations);
+			setWindowTitle(&windows[0], title);
+			displayedStats = renderStats;
+		}
+
+		// Inputs added since the last frame are on screen now, at the front of the list
+		if (commandLine.stats || commandLine.latencyPath || hud.visible) {
+			uint64 presentTime = getMicroseconds();
+			forloop(playerIndex, players.size())
+			{
+				const PlayerInputs& player = players[playerIndex];
+				uint newInputs = std::min(player.list.insertCount - presentedInsertCounts[playerIndex], visibleInputs[playerIndex]);
+				forloop(i, newInputs)
+				{
+					recordLatency(&latency, presentTime - player.list.inputs[i].inputTime);
+				}
+			}
+		}
+		forloop(player, players.size())
+		{
+			presentedInsertCounts[player] = players[player].list.insertCount;
+		}
 		++frameCount;
+		renderStats.frameAllocations = getThreadAllocationCount() - frameStartAllocations;
+
+		if (traceSaveRequested) {
+			traceSaveRequested = 0;
+			if (saveTrace(commandLine.tracePath)) fprintf(stderr, "saved trace to %s\n", commandLine.tracePath);
+		}
 	}
 
+	if (watch) {
+		stopHotReload(&hotReload);
+	}
+	if (commandLine.controlPort) {
+		stopControlServer(&controlServer);
+	}
+	if (commandLine.sharedMemoryName) {
+		stopSharedListPublisher(&publisher);
+	}
+	if (streamEvents) {
+		stopEventStreamServer(&eventServer);
+	}
+	if (injectInput) {
+		stopInjectionServer(&injection);
+	}
+	stopJobQueue(&jobs);
+	if (commandLine.tracePath) {
+		saveTrace(commandLine.tracePath);
+	}
+	if (commandLine.latencyPath) {
+		char latencySummary[128];
+		formatLatencySummary(latency, latencySummary, sizeof(latencySummary));
+		printf("%s\n", latencySummary);
+		saveLatencyHistogram(latency, commandLine.latencyPath);
+	}
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,212 @@
+// Recognizes motion inputs, like quarter circles and dragon punches, as they're made.
+// Each direction change and button press is a symbol, and every profile's motions are compiled into one
+// automaton over those symbols (Aho-Corasick, with every missing transition filled in). Feeding a symbol
+// is a single table lookup whatever the number of motions, so a whole roster's worth costs the same per
+// input as one.
+//
+// A motion's leniency is how many of its steps, other than the last, can be missed. It's compiled in as
+// extra patterns with those steps left out, so it doesn't cost anything per input either.
+// A motion's window is the most frames from its first step to its last, checked against the frame numbers
+// of the last few symbols when the automaton reaches the end of a pattern.
+
+// A motion as written in the config
+struct MotionPattern
+{
+	// Symbols from getDirectionSymbol and getButtonSymbol
+	std::vector<uint> steps;
+	uint window;
+	uint leniency;
+	// Index into Config::images
+	uint image;
+};
+
+// A pattern the automaton has read the whole of, when it reaches the state the match belongs to
+struct MotionMatch
+{
+	// Index into Config::images
+	uint image;
+	uint window;
+	// Number of symbols the pattern takes up, which is fewer than the motion's steps if some were left out
+	uint span;
+};
+
+struct MotionRecognizer
+{
+	static const uint directionSymbolCount = 9;
+	static const uint symbolCount = directionSymbolCount + Input::Joystick::State::buttonCount;
+	static const uint maxSteps = 16;
+	static const uint maxLeniency = 3;
+	// The next state for each state and symbol, symbolCount per state. State 0 is the start.
+	std::vector<uint> transitions;
+	// Each state's matches are matches[matchStarts[state]] up to matches[matchStarts[state+1]],
+	// longest motion first, so a motion isn't hidden by a shorter one that ends the same way.
+	std::vector<uint> matchStarts;
+	std::vector<MotionMatch> matches;
+};
+
+// Where a player is in the automaton
+struct MotionState
+{
+	// The recognizer the state belongs to. Feeding a different one starts over.
+	const MotionRecognizer* recognizer;
+	uint state;
+	uint inputCount;
+	// Frame numbers of the last maxSteps symbols, indexed by inputCount
+	uint frames[MotionRecognizer::maxSteps];
+};
+
+// Directions are numbered like a numeric keypad, minus one: 0 is down-left, 4 is center and 8 is up-right.
+// Opposite directions held together cancel out.
+uint getDirectionSymbol(uint direction)
+{
+	uint vertical = direction & (SDL_HAT_UP|SDL_HAT_DOWN);
+	uint horizontal = direction & (SDL_HAT_LEFT|SDL_HAT_RIGHT);
+	uint row = vertical == SDL_HAT_DOWN ? 0 : vertical == SDL_HAT_UP ? 2 : 1;
+	uint column = horizontal == SDL_HAT_LEFT ? 0 : horizontal == SDL_HAT_RIGHT ? 2 : 1;
+	return row*3 + column;
+}
+
+uint getButtonSymbol(uint button)
+{
+	return MotionRecognizer::directionSymbolCount + button;
+}
+
+// Add every version of a pattern with up to leniency of its steps left out, keeping the last step
+// and at least two steps in all
+void addMotionVariants(std::vector<std::vector<uint> >* out, const std::vector<uint>& steps, uint leniency, uint first, std::vector<uint>* variant)
+{
+	if (first == steps.size()-1) {
+		variant->push_back(steps.back());
+		out->push_back(*variant);
+		variant->pop_back();
+		return;
+	}
+	variant->push_back(steps[first]);
+	addMotionVariants(out, steps, leniency, first+1, variant);
+	variant->pop_back();
+	uint stepsLeft = variant->size() + steps.size()-first;
+	if (leniency > 0 && stepsLeft > 2) {
+		addMotionVariants(out, steps, leniency-1, first+1, variant);
+	}
+}
+
+// Build the automaton for a profile's motions. Only done when a config is parsed, so it can take its time.
+void compileMotions(MotionRecognizer* out, const std::vector<MotionPattern>& patterns)
+{
+	const uint symbolCount = MotionRecognizer::symbolCount;
+	out->transitions.assign(symbolCount, 0);
+	out->matchStarts.clear();
+	out->matches.clear();
+	if (patterns.empty()) {
+		out->matchStarts.assign(2, 0);
+		return;
+	}
+
+	// While building the trie, 0 means there's no transition yet, since nothing leads back to the start
+	struct Output { uint pattern; uint span; };
+	std::vector<std::vector<Output> > outputs(1);
+	forloop(patternIndex, patterns.size())
+	{
+		const MotionPattern& pattern = patterns[patternIndex];
+		std::vector<std::vector<uint> > variants;
+		std::vector<uint> variant;
+		addMotionVariants(&variants, pattern.steps, std::min(pattern.leniency, (uint)MotionRecognizer::maxLeniency), 0, &variant);
+		forloop(variantIndex, variants.size())
+		{
+			uint state = 0;
+			forloop(i, variants[variantIndex].size())
+			{
+				uint* next = &out->transitions[state*symbolCount + variants[variantIndex][i]];
+				if (!*next) {
+					*next = outputs.size();
+					outputs.resize(outputs.size()+1);
+					out->transitions.resize(out->transitions.size() + symbolCount, 0);
+					// The resize may have moved the transitions
+					next = &out->transitions[state*symbolCount + variants[variantIndex][i]];
+				}
+				state = *next;
+			}
+			Output output ={patternIndex, (uint)variants[variantIndex].size()};
+			outputs[state].push_back(output);
+		}
+	}
+
+	// Breadth first, so each state's fallback, the longest suffix of it that's also in the trie,
+	// is finished before the state itself. Missing transitions go where the fallback's would.
+	uint stateCount = outputs.size();
+	std::vector<uint> fallbacks(stateCount, 0);
+	std::vector<uint> queue;
+	queue.reserve(stateCount);
+	forloop(symbol, symbolCount)
+	{
+		if (out->transitions[symbol]) queue.push_back(out->transitions[symbol]);
+	}
+	forloop(queueIndex, queue.size())
+	{
+		uint state = queue[queueIndex];
+		// Matches of the fallback end here too
+		outputs[state].insert(outputs[state].end(), outputs[fallbacks[state]].begin(), outputs[fallbacks[state]].end());
+		forloop(symbol, symbolCount)
+		{
+			uint* next = &out->transitions[state*symbolCount + symbol];
+			uint fallbackNext = out->transitions[fallbacks[state]*symbolCount + symbol];
+			if (*next) {
+				fallbacks[*next] = fallbackNext;
+				queue.push_back(*next);
+			}
+			else {
+				*next = fallbackNext;
+			}
+		}
+	}
+
+	// Longest motion first, then config order, keeping each motion's shortest span since that's the
+	// likeliest to fit in its window
+	out->matchStarts.resize(stateCount+1);
+	forloop(state, stateCount)
+	{
+		out->matchStarts[state] = out->matches.size();
+		std::vector<Output>* stateOutputs = &outputs[state];
+		std::sort(stateOutputs->begin(), stateOutputs->end(), [&](const Output& a, const Output& b) {
+			if (a.pattern != b.pattern) {
+				uint aLength = patterns[a.pattern].steps.size();
+				uint bLength = patterns[b.pattern].steps.size();
+				return aLength != bLength ? aLength > bLength : a.pattern < b.pattern;
+			}
+			return a.span < b.span;
+		});
+		forloop(i, stateOutputs->size())
+		{
+			if (i > 0 && (*stateOutputs)[i].pattern == (*stateOutputs)[i-1].pattern) continue;
+			const MotionPattern& pattern = patterns[(*stateOutputs)[i].pattern];
+			MotionMatch match ={pattern.image, pattern.window, (*stateOutputs)[i].span};
+			out->matches.push_back(match);
+		}
+	}
+	out->matchStarts[stateCount] = out->matches.size();
+}
+
+// Forget the inputs fed so far, like after the config is reloaded
+void resetMotionState(MotionState* out)
+{
+	out->recognizer = 0;
+}
+
+// Feed one symbol. Returns the longest motion it completes within that motion's window, or 0 if it doesn't complete one.
+const MotionMatch* feedMotionInput(MotionState* mod, const MotionRecognizer& recognizer, uint symbol, uint frameNumber)
+{
+	if (mod->recognizer != &recognizer) {
+		mod->recognizer = &recognizer;
+		mod->state = 0;
+		mod->inputCount = 0;
+	}
+	mod->state = recognizer.transitions[mod->state*MotionRecognizer::symbolCount + symbol];
+	mod->frames[mod->inputCount % MotionRecognizer::maxSteps] = frameNumber;
+	++mod->inputCount;
+	for (uint i=recognizer.matchStarts[mod->state]; i<recognizer.matchStarts[mod->state+1]; ++i) {
+		const MotionMatch& match = recognizer.matches[i];
+		uint firstFrame = mod->frames[(mod->inputCount - match.span) % MotionRecognizer::maxSteps];
+		if (frameNumber - firstFrame <= match.window) return &match;
+	}
+	return 0;
+}
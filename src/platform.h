@@ -1,15 +1,41 @@
 #ifdef WIN32
 // Use Win32 window backend instead of SDL (allows transparent background)
 #define WINDOW_WIN32
+// Before windows.h, which otherwise pulls in the old winsock.h
+#include <winsock2.h>
 #include <windows.h>
 #include <dwmapi.h>
 #endif
 #include "SDL/SDL.h"
 #include "SDL/SDL_video.h"
 #include "SDL/SDL_syswm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/un.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#endif
+#include <string>
+#include <vector>
 
 #define forloop(i,end) for(unsigned int i=0; i<(end); i++)
 typedef unsigned int uint;
+typedef unsigned long long uint64;
+
+struct Config;
 
 struct Input
 {
@@ -24,29 +50,103 @@ struct Input
 		State current;
 		State previous;
 		SDL_Joystick* sdlJoy;
+		char guid[33];
+		const char* name;
+		// The profile whose mappings this joystick uses, or 0 for the active one. Set by the program after the joystick opens.
+		const Config* profile;
 	};
 
 	static const uint supportedKeyCount = 0xFF;
 	bool keyboard[supportedKeyCount];
 	uint joystickCount;
 	Joystick* joysticks;
+	// Set when joysticks were opened or closed by the last updateInput
+	bool joysticksChanged;
+	// When the joysticks were last read, in getMicroseconds time. Joysticks are polled, so this is the closest
+	// thing to a hardware timestamp for their current state.
+	uint64 pollTime;
+};
+
+struct FileInfo
+{
+	// In platform specific units. Only useful for checking if a file changed.
+	uint64 modifiedTime;
+	uint64 size;
+};
+
+// A read-only view of a whole file
+struct MappedFile
+{
+	const unsigned char* data;
+	size_t size;
+};
+
+// Memory that other processes can map by name
+struct SharedMemory
+{
+	unsigned char* data;
+	size_t size;
+	std::string name;
+#ifdef WIN32
+	HANDLE mapping;
+#endif
+};
+
+// Waits for changes to files in a set of directories.
+// Uses change notifications on Windows and inotify on Linux. Elsewhere it just wakes up periodically.
+struct FileWatcher
+{
+	std::vector<std::string> directories;
+#if defined(WIN32)
+	std::vector<HANDLE> changeHandles;
+	HANDLE wakeEvent;
+#elif defined(__linux__)
+	int inotify;
+	int wakeEvent;
+#endif
+};
+
+// Key codes used by WindowMessages and hotkeys. Digits and letters are their uppercase character codes.
+const uint keyF1 = 0x100; // F1 to F12 are keyF1 to keyF1+11
+
+// What happened to the window since the last processWindowMessages
+struct WindowMessages
+{
+	static const uint maxPressedKeys = 16;
+	bool quit;
+	// Keys pressed while the window had focus, or registered hotkeys pressed anywhere. Repeats aren't counted.
+	uint pressedKeys[maxPressedKeys];
+	uint pressedKeyCount;
 };
 
 struct Window
 {
 	#ifdef WINDOW_WIN32
 		HWND hwnd;
+		HGLRC renderingContext;
+		static const uint maxHotkeys = 32;
+		uint hotkeys[maxHotkeys];
+		uint hotkeyCount;
 	#else
 		SDL_Window* win;
 		SDL_GLContext context;
 	#endif
 };
 
+// Microseconds since an arbitrary starting point, for measuring how long things take
+uint64 getMicroseconds()
+{
+	static const uint64 frequency = SDL_GetPerformanceFrequency();
+	uint64 counter = SDL_GetPerformanceCounter();
+	return counter / frequency * 1000000 + counter % frequency * 1000000 / frequency;
+}
+
 void updateInput(Input* input)
 {
 	// Handle joysticks beening plugged in or taken out
 	int joystickCount = SDL_NumJoysticks();
-	if (joystickCount != input->joystickCount)
+	input->joysticksChanged = (uint)joystickCount != input->joystickCount;
+	if (input->joysticksChanged)
 	{
 		// Free joysticks
 		forloop(i, input->joystickCount)
@@ -59,12 +159,18 @@ void updateInput(Input* input)
 		input->joysticks = new Input::Joystick[joystickCount];
 		forloop(i, input->joystickCount)
 		{
-			input->joysticks[i].sdlJoy = SDL_JoystickOpen(i);
+			Input::Joystick* joystick = &input->joysticks[i];
+			joystick->sdlJoy = SDL_JoystickOpen(i);
+			SDL_JoystickGetGUIDString(SDL_JoystickGetGUID(joystick->sdlJoy), joystick->guid, sizeof(joystick->guid));
+			joystick->name = SDL_JoystickName(joystick->sdlJoy);
+			if (!joystick->name) joystick->name = "";
+			joystick->profile = 0;
 		}
 	}
 
 	// Update joystick
 	SDL_JoystickUpdate();
+	input->pollTime = getMicroseconds();
 	forloop(joystickIndex, input->joystickCount)
 	{
 		Input::Joystick* joystick = &input->joysticks[joystickIndex];
@@ -118,11 +224,10 @@ LRESULT CALLBACK WindowProcedure(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPar
 }
 #endif
 
-void createWindow(Window* out)
+// Create a window with an OpenGL context. Windows created with shareWith draw with its context instead of
+// their own, so textures and other OpenGL objects work in every window. Call makeWindowCurrent before drawing to one.
+void createWindow(Window* out, int width = 600, int height = 100, const Window* shareWith = 0)
 {
-	int width = 600;
-	int height = 100;
-
 #ifdef WINDOW_WIN32
 	// Create window
 	WNDCLASS wnd ={0};
@@ -150,12 +255,30 @@ void createWindow(Window* out)
 	HDC deviceContext = GetDC(out->hwnd);
 	int actualFormat = ChoosePixelFormat(deviceContext, &requestedFormat);
 	SetPixelFormat(deviceContext, actualFormat, &requestedFormat);
-	HGLRC renderingContext = wglCreateContext(deviceContext);
-	wglMakeCurrent(deviceContext, renderingContext);
+	out->renderingContext = shareWith ? shareWith->renderingContext : wglCreateContext(deviceContext);
+	wglMakeCurrent(deviceContext, out->renderingContext);
 	ReleaseDC(out->hwnd, deviceContext);
 #else
 	out->win = SDL_CreateWindow(0, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width, height, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
-	out->context = SDL_GL_CreateContext(out->win);
+	if (shareWith) {
+		out->context = shareWith->context;
+		SDL_GL_MakeCurrent(out->win, out->context);
+	}
+	else {
+		out->context = SDL_GL_CreateContext(out->win);
+	}
+#endif
+}
+
+// Draw to this window from now on
+void makeWindowCurrent(Window* window)
+{
+#ifdef WINDOW_WIN32
+	HDC deviceContext = GetDC(window->hwnd);
+	wglMakeCurrent(deviceContext, window->renderingContext);
+	ReleaseDC(window->hwnd, deviceContext);
+#else
+	SDL_GL_MakeCurrent(window->win, window->context);
 #endif
 }
 
@@ -187,28 +310,87 @@ void setWindowStyle(Window* mod, bool alwaysOnTop, bool transparentBackground)
 #endif
 }
 
-void processWindowMessages(Window* window, bool* out_quit)
+void addPressedKey(WindowMessages* messages, uint key)
+{
+	if (messages->pressedKeyCount < WindowMessages::maxPressedKeys) {
+		messages->pressedKeys[messages->pressedKeyCount++] = key;
+	}
+}
+
+// Messages for every window are handled together. Closing any of them quits.
+void processWindowMessages(Window* windows, uint windowCount, WindowMessages* out)
 {
-	*out_quit = false;
+	out->quit = false;
+	out->pressedKeyCount = 0;
 #ifdef WINDOW_WIN32
 	MSG msg;
 	while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
 	{
 		TranslateMessage(&msg);
 		DispatchMessage(&msg);
-		if (msg.message == WM_QUIT) *out_quit = true;
+		if (msg.message == WM_QUIT) out->quit = true;
+		// Bit 30 is set for repeats of a held key
+		if (msg.message == WM_KEYDOWN && !(msg.lParam & (1 << 30))) {
+			uint key = (uint)msg.wParam;
+			if (key >= VK_F1 && key <= VK_F12) key = keyF1 + key - VK_F1;
+			addPressedKey(out, key);
+		}
+		// Hotkeys are registered with their key code as the id
+		if (msg.message == WM_HOTKEY) addPressedKey(out, (uint)msg.wParam);
 	}
 #else
 	SDL_Event message;
 	while (SDL_PollEvent(&message)) {
 		if (message.type == SDL_QUIT) {
-			*out_quit = true;
+			out->quit = true;
 		}
-		else if (message.window.event == SDL_WINDOWEVENT_FOCUS_GAINED) {
-			SDL_SetWindowBordered(window->win, SDL_TRUE);
+		else if (message.type == SDL_KEYDOWN) {
+			if (!message.key.repeat) {
+				uint key = (uint)message.key.keysym.sym;
+				if (key >= 'a' && key <= 'z') key += 'A' - 'a';
+				if (key >= SDLK_F1 && key <= SDLK_F12) key = keyF1 + key - SDLK_F1;
+				addPressedKey(out, key);
+			}
 		}
-		else if (message.window.event == SDL_WINDOWEVENT_FOCUS_LOST) {
-			SDL_SetWindowBordered(window->win, SDL_FALSE);
+		else if (message.type == SDL_WINDOWEVENT) {
+			SDL_Window* window = 0;
+			forloop(i, windowCount)
+			{
+				if (SDL_GetWindowID(windows[i].win) == message.window.windowID) window = windows[i].win;
+			}
+			if (!window) continue;
+			if (message.window.event == SDL_WINDOWEVENT_CLOSE) {
+				out->quit = true;
+			}
+			else if (message.window.event == SDL_WINDOWEVENT_FOCUS_GAINED) {
+				SDL_SetWindowBordered(window, SDL_TRUE);
+			}
+			else if (message.window.event == SDL_WINDOWEVENT_FOCUS_LOST) {
+				SDL_SetWindowBordered(window, SDL_FALSE);
+			}
+		}
+	}
+#endif
+}
+
+// Keys that switch something even when the window isn't focused, replacing any set before.
+// Only the Win32 backend has global hotkeys. With SDL they work while the window is focused.
+// Globally, letters and digits need Ctrl+Alt held, so they can still be typed in other programs. Function keys don't.
+void setHotkeys(Window* mod, const uint* keys, uint keyCount)
+{
+#ifdef WINDOW_WIN32
+	forloop(i, mod->hotkeyCount)
+	{
+		UnregisterHotKey(mod->hwnd, mod->hotkeys[i]);
+	}
+	mod->hotkeyCount = 0;
+	forloop(i, keyCount)
+	{
+		if (mod->hotkeyCount == Window::maxHotkeys) break;
+		uint virtualKey = keys[i] >= keyF1 ? VK_F1 + keys[i] - keyF1 : keys[i];
+		UINT modifiers = keys[i] >= keyF1 ? MOD_NOREPEAT : MOD_NOREPEAT | MOD_CONTROL | MOD_ALT;
+		if (RegisterHotKey(mod->hwnd, keys[i], modifiers, virtualKey)) {
+			mod->hotkeys[mod->hotkeyCount++] = keys[i];
 		}
 	}
 #endif
@@ -226,6 +408,15 @@ void getWindowSize(Window window, int* out_width, int* out_height)
 #endif
 }
 
+void setWindowTitle(Window* window, const char* title)
+{
+#ifdef WINDOW_WIN32
+	SetWindowText(window->hwnd, title);
+#else
+	SDL_SetWindowTitle(window->win, title);
+#endif
+}
+
 void swapBuffers(Window* window)
 {
 #ifdef WINDOW_WIN32
@@ -235,4 +426,422 @@ void swapBuffers(Window* window)
 #else
 	SDL_GL_SwapWindow(window->win);
 #endif
-}
\ No newline at end of file
+}
+
+// 64 bit FNV-1a
+uint64 hashBytes(const unsigned char* data, size_t size)
+{
+	uint64 hash = 0xcbf29ce484222325ull;
+	forloop(i, size)
+	{
+		hash ^= data[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+bool readEntireFile(const char* filePath, std::vector<unsigned char>* out)
+{
+	out->clear();
+	FILE* file = fopen(filePath, "rb");
+	if (!file) return false;
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	bool success = false;
+	if (size >= 0) {
+		out->resize(size);
+		success = fread(out->data(), 1, size, file) == (size_t)size;
+	}
+	fclose(file);
+	return success;
+}
+
+// Absolute path with links and relative parts resolved, so two spellings of the same file compare equal.
+// Returns the path unchanged if it can't be resolved, e.g. because the file doesn't exist.
+std::string canonicalPath(const char* filePath)
+{
+#ifdef WIN32
+	char buffer[MAX_PATH];
+	DWORD length = GetFullPathNameA(filePath, MAX_PATH, buffer, 0);
+	if (length == 0 || length >= MAX_PATH) return filePath;
+	// Windows paths aren't case sensitive
+	CharLowerBuffA(buffer, length);
+	return std::string(buffer, length);
+#else
+	char* resolved = realpath(filePath, 0);
+	if (!resolved) return filePath;
+	std::string result = resolved;
+	free(resolved);
+	return result;
+#endif
+}
+
+bool getFileInfo(const char* filePath, FileInfo* out)
+{
+#ifdef WIN32
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(filePath, GetFileExInfoStandard, &attributes)) return false;
+	out->modifiedTime = ((uint64)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+	out->size = ((uint64)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+#else
+	struct stat attributes;
+	if (stat(filePath, &attributes) != 0) return false;
+	out->modifiedTime = (uint64)attributes.st_mtim.tv_sec*1000000000ull + attributes.st_mtim.tv_nsec;
+	out->size = attributes.st_size;
+#endif
+	return true;
+}
+
+bool mapFile(MappedFile* out, const char* filePath)
+{
+	out->data = 0;
+	out->size = 0;
+#ifdef WIN32
+	HANDLE file = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER size;
+	HANDLE mapping = 0;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+		mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+	}
+	if (mapping) {
+		out->data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		out->size = out->data ? (size_t)size.QuadPart : 0;
+		// The view keeps the file open
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+#else
+	int file = open(filePath, O_RDONLY);
+	if (file < 0) return false;
+	struct stat attributes;
+	if (fstat(file, &attributes) == 0 && attributes.st_size > 0) {
+		void* data = mmap(0, attributes.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data != MAP_FAILED) {
+			out->data = (const unsigned char*)data;
+			out->size = attributes.st_size;
+		}
+	}
+	close(file);
+#endif
+	return out->data != 0;
+}
+
+void unmapFile(MappedFile* mod)
+{
+	if (!mod->data) return;
+#ifdef WIN32
+	UnmapViewOfFile(mod->data);
+#else
+	munmap((void*)mod->data, mod->size);
+#endif
+	mod->data = 0;
+	mod->size = 0;
+}
+
+// Create a named block of shared memory, filled with zeros, or open the existing one and resize it.
+// The name is a plain word like "input-display", made into a POSIX shm name or a Windows session local name.
+bool createSharedMemory(SharedMemory* out, const char* name, size_t size)
+{
+	out->data = 0;
+	out->size = 0;
+#ifdef WIN32
+	out->name = std::string("Local\\") + name;
+	out->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, 0, PAGE_READWRITE, (DWORD)((uint64)size >> 32), (DWORD)size, out->name.c_str());
+	if (!out->mapping) return false;
+	out->data = (unsigned char*)MapViewOfFile(out->mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (!out->data) {
+		CloseHandle(out->mapping);
+		return false;
+	}
+	memset(out->data, 0, size);
+#else
+	out->name = std::string("/") + name;
+	int file = shm_open(out->name.c_str(), O_CREAT | O_RDWR, 0644);
+	if (file < 0) return false;
+	// Truncating to 0 first clears anything left by an earlier run
+	if (ftruncate(file, 0) != 0 || ftruncate(file, size) != 0) {
+		close(file);
+		return false;
+	}
+	void* data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	close(file);
+	if (data == MAP_FAILED) return false;
+	out->data = (unsigned char*)data;
+#endif
+	out->size = size;
+	return true;
+}
+
+// Unmap the memory and remove its name. Processes that still have it mapped keep their mapping.
+void destroySharedMemory(SharedMemory* mod)
+{
+	if (!mod->data) return;
+#ifdef WIN32
+	UnmapViewOfFile(mod->data);
+	CloseHandle(mod->mapping);
+#else
+	munmap(mod->data, mod->size);
+	shm_unlink(mod->name.c_str());
+#endif
+	mod->data = 0;
+	mod->size = 0;
+}
+
+void createDirectory(const char* path)
+{
+#ifdef WIN32
+	CreateDirectoryA(path, 0);
+#else
+	mkdir(path, 0755);
+#endif
+}
+
+// Move a file over another one, so readers see either the old file or the new one but never a partial write
+bool replaceFile(const char* from, const char* to)
+{
+#ifdef WIN32
+	return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(from, to) == 0;
+#endif
+}
+
+// The directory part of a path, or "." if it doesn't have one
+std::string directoryOfPath(const std::string& filePath)
+{
+	size_t slash = filePath.find_last_of("/\\");
+	if (slash == std::string::npos) return ".";
+	if (slash == 0) return filePath.substr(0, 1);
+	return filePath.substr(0, slash);
+}
+
+void createFileWatcher(FileWatcher* out)
+{
+#if defined(WIN32)
+	out->wakeEvent = CreateEventA(0, FALSE, FALSE, 0);
+#elif defined(__linux__)
+	out->inotify = inotify_init1(IN_CLOEXEC);
+	out->wakeEvent = eventfd(0, EFD_CLOEXEC);
+#endif
+}
+
+void destroyFileWatcher(FileWatcher* mod)
+{
+#if defined(WIN32)
+	forloop(i, mod->changeHandles.size())
+	{
+		FindCloseChangeNotification(mod->changeHandles[i]);
+	}
+	mod->changeHandles.clear();
+	CloseHandle(mod->wakeEvent);
+#elif defined(__linux__)
+	close(mod->inotify);
+	close(mod->wakeEvent);
+#endif
+	mod->directories.clear();
+}
+
+// Watch a directory for files being written, created, renamed or deleted. Adding a directory twice does nothing.
+void watchDirectory(FileWatcher* mod, const std::string& directory)
+{
+	forloop(i, mod->directories.size())
+	{
+		if (mod->directories[i] == directory) return;
+	}
+	mod->directories.push_back(directory);
+#if defined(WIN32)
+	HANDLE change = FindFirstChangeNotificationA(directory.c_str(), FALSE,
+		FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE);
+	// WaitForMultipleObjects can't wait on more handles than this, counting the wake event
+	if (change != INVALID_HANDLE_VALUE && mod->changeHandles.size() < MAXIMUM_WAIT_OBJECTS-1) {
+		mod->changeHandles.push_back(change);
+	}
+#elif defined(__linux__)
+	// Editors often save by writing a new file and renaming it over the old one, so watch the directory rather than the file
+	inotify_add_watch(mod->inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+#endif
+}
+
+// Block until something changes in a watched directory, the timeout passes, or wakeFileWatcher is called.
+// Returns true if a change was seen. Only says that something changed, not what.
+bool waitForFileChanges(FileWatcher* mod, uint timeoutMilliseconds)
+{
+#if defined(WIN32)
+	std::vector<HANDLE> handles = mod->changeHandles;
+	handles.push_back(mod->wakeEvent);
+	DWORD result = WaitForMultipleObjects(handles.size(), handles.data(), FALSE, timeoutMilliseconds);
+	if (result >= WAIT_OBJECT_0 && result < WAIT_OBJECT_0 + mod->changeHandles.size()) {
+		FindNextChangeNotification(mod->changeHandles[result - WAIT_OBJECT_0]);
+		return true;
+	}
+	return false;
+#elif defined(__linux__)
+	pollfd polls[2];
+	polls[0].fd = mod->inotify;
+	polls[0].events = POLLIN;
+	polls[1].fd = mod->wakeEvent;
+	polls[1].events = POLLIN;
+	if (poll(polls, 2, timeoutMilliseconds) <= 0) return false;
+	if (polls[1].revents & POLLIN) {
+		uint64 count;
+		if (read(mod->wakeEvent, &count, sizeof(count)) < 0 && errno != EAGAIN && errno != EINTR) {
+			fprintf(stderr, "couldn't read the file watcher's wake event: %s\n", strerror(errno));
+		}
+	}
+	if (polls[0].revents & POLLIN) {
+		// The events themselves aren't needed, just drain them. If the read is interrupted, they're seen on the next wait.
+		char events[4096];
+		ssize_t size = read(mod->inotify, events, sizeof(events));
+		if (size < 0) {
+			if (errno != EAGAIN && errno != EINTR) fprintf(stderr, "couldn't read file change events: %s\n", strerror(errno));
+			return false;
+		}
+		if ((size_t)size < sizeof(inotify_event)) {
+			fprintf(stderr, "file change events were cut short\n");
+			return false;
+		}
+		return true;
+	}
+	return false;
+#else
+	SDL_Delay(timeoutMilliseconds);
+	return true;
+#endif
+}
+
+// Make waitForFileChanges return early. Can be called from any thread.
+void wakeFileWatcher(FileWatcher* mod)
+{
+#if defined(WIN32)
+	SetEvent(mod->wakeEvent);
+#elif defined(__linux__)
+	uint64 count = 1;
+	// EAGAIN means the counter is full, so the watcher is already being woken
+	if (write(mod->wakeEvent, &count, sizeof(count)) < 0 && errno != EAGAIN && errno != EINTR) {
+		fprintf(stderr, "couldn't wake the file watcher: %s\n", strerror(errno));
+	}
+#endif
+}
+
+#ifdef WIN32
+typedef SOCKET Socket;
+const Socket invalidSocket = INVALID_SOCKET;
+#else
+typedef int Socket;
+const Socket invalidSocket = -1;
+#endif
+
+void startSockets()
+{
+#ifdef WIN32
+	WSADATA data;
+	WSAStartup(MAKEWORD(2, 2), &data);
+#endif
+}
+
+void closeSocket(Socket socket)
+{
+#ifdef WIN32
+	closesocket(socket);
+#else
+	close(socket);
+#endif
+}
+
+void setSocketNonBlocking(Socket socket)
+{
+#ifdef WIN32
+	u_long nonBlocking = 1;
+	ioctlsocket(socket, FIONBIO, &nonBlocking);
+#else
+	fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+// Listen for connections from this computer only. Returns invalidSocket if the port can't be used.
+Socket listenOnLocalPort(uint port)
+{
+	Socket listener = socket(AF_INET, SOCK_STREAM, 0);
+	if (listener == invalidSocket) return invalidSocket;
+	int reuse = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons((unsigned short)port);
+	if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 8) != 0) {
+		closeSocket(listener);
+		return invalidSocket;
+	}
+	setSocketNonBlocking(listener);
+	return listener;
+}
+
+// Listen for connections on a Unix domain socket at the given path, replacing any socket file left there.
+// Not supported on Windows, where it returns invalidSocket.
+Socket listenOnLocalSocket(const char* path)
+{
+#ifdef WIN32
+	return invalidSocket;
+#else
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address.sun_path)) return invalidSocket;
+	strcpy(address.sun_path, path);
+	Socket listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener == invalidSocket) return invalidSocket;
+	unlink(path);
+	if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 8) != 0) {
+		closeSocket(listener);
+		return invalidSocket;
+	}
+	setSocketNonBlocking(listener);
+	return listener;
+#endif
+}
+
+// Returns a waiting connection, or invalidSocket if there isn't one. Never blocks.
+Socket acceptConnection(Socket listener)
+{
+	Socket connection = accept(listener, 0, 0);
+	if (connection != invalidSocket) {
+		setSocketNonBlocking(connection);
+	}
+	return connection;
+}
+
+bool socketWouldBlock()
+{
+#ifdef WIN32
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+	return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+// Returns the number of bytes received, 0 if nothing has arrived, or -1 if the connection was closed
+int receiveBytes(Socket socket, void* buffer, uint size)
+{
+	int received = (int)recv(socket, (char*)buffer, size, 0);
+	if (received > 0) return received;
+	if (received < 0 && socketWouldBlock()) return 0;
+	return -1;
+}
+
+// Returns the number of bytes sent, which is 0 if the connection's buffer is full, or -1 if the connection was closed
+int sendBytes(Socket socket, const void* data, uint size)
+{
+#ifdef WIN32
+	int sent = send(socket, (const char*)data, size, 0);
+#else
+	// Don't raise SIGPIPE when the other end has gone
+	int sent = (int)send(socket, data, size, MSG_NOSIGNAL);
+#endif
+	if (sent >= 0) return sent;
+	if (socketWouldBlock()) return 0;
+	return -1;
+}
@@ -0,0 +1,187 @@
+#include <atomic>
+
+// Publishes the input list in shared memory, so other programs like OBS plugins or scoreboards can show it
+// without capturing the window. Any number of readers can read the memory in place, each at its own rate.
+//
+// The memory is guarded by a seqlock: the writer makes the sequence odd while it changes anything and even
+// again when it's done, and never waits for readers. To read a consistent snapshot, a reader
+//   1. reads the sequence, and tries again later if it's odd
+//   2. reads what it needs
+//   3. reads the sequence again, and if it changed, throws away what it read and starts over
+// beginSharedListRead and sharedListReadValid do steps 1 and 3.
+//
+// Layout: SharedListHeader, SharedListEntry[entryCapacity], then imageCapacity image paths of pathSize bytes each.
+// All values are in the writer's native byte order.
+
+struct SharedListHeader
+{
+	static const uint expectedMagic = 0x4C534449; // "IDSL"
+	static const uint expectedVersion = 2;
+	uint magic;
+	uint version;
+	uint entryCapacity;
+	uint imageCapacity;
+	uint pathSize;
+	uint entriesOffset;
+	uint imagesOffset;
+
+	std::atomic<uint> sequence;
+	// Entries in every player's list, front first, one player after another. If they don't all fit in
+	// entryCapacity, the last entries are left out.
+	uint entryCount;
+	// Number of players, which each have their own list with --players
+	uint playerCount;
+	// Image paths published, indexed by image id. Ids aren't reused, so paths are only ever added.
+	uint imageCount;
+	// Total inputs ever added to all the lists
+	uint insertCount;
+	// The program's frame number when the list was last changed
+	uint frameNumber;
+	// When the list was last published, in the same clock as the entries' input times
+	uint64 publishTime;
+};
+
+struct SharedListEntry
+{
+	// Numbers a player's inputs in the order they were added, starting from 0, so readers can tell which ones are new
+	uint id;
+	// Inputs with the same frame number were added together and are drawn in the same slot
+	uint frameNumber;
+	// When the input was read, in microseconds from an arbitrary starting point
+	uint64 inputTime;
+	// Index into the image paths
+	uint image;
+	// The player whose list the input is in, from 0
+	uint player;
+};
+
+struct SharedListPublisher
+{
+	static const uint entryCapacity = 1024;
+	static const uint imageCapacity = 1024;
+	static const uint pathSize = 256;
+	SharedMemory memory;
+	SharedListHeader* header;
+	// What's been published, to skip frames where nothing changed
+	uint publishedInsertCount;
+	uint publishedEntryCount;
+	uint publishedPlayerCount;
+};
+
+bool startSharedListPublisher(SharedListPublisher* out, const char* name)
+{
+	size_t entriesOffset = sizeof(SharedListHeader);
+	size_t imagesOffset = entriesOffset + SharedListPublisher::entryCapacity*sizeof(SharedListEntry);
+	size_t size = imagesOffset + SharedListPublisher::imageCapacity*SharedListPublisher::pathSize;
+	out->header = 0;
+	if (!createSharedMemory(&out->memory, name, size)) return false;
+	SharedListHeader* header = (SharedListHeader*)out->memory.data;
+	header->entryCapacity = SharedListPublisher::entryCapacity;
+	header->imageCapacity = SharedListPublisher::imageCapacity;
+	header->pathSize = SharedListPublisher::pathSize;
+	header->entriesOffset = (uint)entriesOffset;
+	header->imagesOffset = (uint)imagesOffset;
+	header->sequence.store(0);
+	header->version = SharedListHeader::expectedVersion;
+	// Written last, so a reader that sees the magic sees the rest of the header
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic = SharedListHeader::expectedMagic;
+	out->header = header;
+	out->publishedInsertCount = 0;
+	out->publishedEntryCount = 0;
+	out->publishedPlayerCount = 0;
+	return true;
+}
+
+void stopSharedListPublisher(SharedListPublisher* mod)
+{
+	destroySharedMemory(&mod->memory);
+	mod->header = 0;
+}
+
+SharedListEntry* getSharedListEntries(SharedListHeader* header)
+{
+	return (SharedListEntry*)((unsigned char*)header + header->entriesOffset);
+}
+
+char* getSharedListImagePath(SharedListHeader* header, uint image)
+{
+	return (char*)header + header->imagesOffset + (size_t)image*header->pathSize;
+}
+
+// Publish the lists if they changed since they were last published, so frames without new inputs cost nothing
+void publishSharedList(SharedListPublisher* mod, const PlayerInputs* players, uint playerCount, const TextureCache& textures, uint frameNumber)
+{
+	SharedListHeader* header = mod->header;
+	uint imageCount = std::min((uint)textures.entries.size(), header->imageCapacity);
+	uint insertCount = 0;
+	uint inputCount = 0;
+	forloop(player, playerCount)
+	{
+		insertCount += players[player].list.insertCount;
+		inputCount += players[player].list.inputs.size();
+	}
+	if (insertCount == mod->publishedInsertCount && inputCount == mod->publishedEntryCount
+		&& playerCount == mod->publishedPlayerCount && imageCount == header->imageCount)
+	{
+		return;
+	}
+	TRACE_SCOPE("publishSharedList");
+
+	uint sequence = header->sequence.load(std::memory_order_relaxed);
+	header->sequence.store(sequence+1, std::memory_order_relaxed);
+	// Keeps the writes below from being seen before the sequence is odd
+	std::atomic_thread_fence(std::memory_order_release);
+
+	for (uint image=header->imageCount; image<imageCount; ++image) {
+		char* path = getSharedListImagePath(header, image);
+		strncpy(path, textures.entries[image].path.c_str(), header->pathSize-1);
+		path[header->pathSize-1] = 0;
+	}
+	header->imageCount = imageCount;
+
+	// Entries move back by one place for each input added, so the whole published part of the lists is rewritten
+	SharedListEntry* entries = getSharedListEntries(header);
+	uint entryCount = 0;
+	forloop(player, playerCount)
+	{
+		const InputDisplayList& list = players[player].list;
+		for (uint i=0; i<list.inputs.size() && entryCount<header->entryCapacity; ++i) {
+			const InputDisplay& input = list.inputs[i];
+			SharedListEntry* entry = &entries[entryCount++];
+			entry->id = list.insertCount-1 - i;
+			entry->frameNumber = input.frameNumber;
+			entry->inputTime = input.inputTime;
+			entry->image = input.image;
+			entry->player = player;
+		}
+	}
+	header->entryCount = entryCount;
+	header->playerCount = playerCount;
+	header->insertCount = insertCount;
+	header->frameNumber = frameNumber;
+	header->publishTime = getMicroseconds();
+
+	header->sequence.store(sequence+2, std::memory_order_release);
+	mod->publishedInsertCount = insertCount;
+	mod->publishedEntryCount = inputCount;
+	mod->publishedPlayerCount = playerCount;
+}
+
+// For readers: wait out a write in progress, then return the sequence to check with sharedListReadValid
+uint beginSharedListRead(const SharedListHeader* header)
+{
+	uint sequence;
+	while ((sequence = header->sequence.load(std::memory_order_acquire)) & 1) {
+		std::this_thread::yield();
+	}
+	return sequence;
+}
+
+// For readers: whether everything read since beginSharedListRead is a consistent snapshot
+bool sharedListReadValid(const SharedListHeader* header, uint sequence)
+{
+	// Keeps the reads before this from being done after the sequence is checked
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return header->sequence.load(std::memory_order_relaxed) == sequence;
+}
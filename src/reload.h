@@ -0,0 +1,230 @@
+// Reloads the config and its images when their files change, without losing the displayed inputs.
+// Files are watched, parsed and decoded on a background thread. The main thread only uploads the results,
+// and swaps a reloaded config in between frames once all of its images are ready.
+struct HotReload
+{
+	std::string configPath;
+	std::string diskCachePath;
+	FileWatcher watcher;
+	std::thread thread;
+
+	// Shared with the reload thread
+	std::mutex mutex;
+	bool quit;
+	// Images the current config uses, which the reload thread should watch
+	std::vector<std::string> imagePaths;
+	bool imagePathsChanged;
+	// Finished work waiting for the main thread
+	bool configReloaded;
+	ConfigSet reloadedConfig;
+	std::vector<TextureCache::Load*> reloadedImages;
+
+	// Main thread only. A reloaded config waits here until its images have loaded.
+	bool configPending;
+	ConfigSet pendingConfig;
+};
+
+void setWatchedImages(HotReload* mod, const ConfigSet& config, const TextureCache& textures)
+{
+	std::lock_guard<std::mutex> lock(mod->mutex);
+	mod->imagePaths.clear();
+	forloop(profileIndex, config.profiles.size())
+	{
+		const Config& profile = config.profiles[profileIndex];
+		forloop(i, profile.images.size())
+		{
+			mod->imagePaths.push_back(textures.entries[profile.images[i]].path);
+		}
+	}
+	mod->imagePathsChanged = true;
+	wakeFileWatcher(&mod->watcher);
+}
+
+void runHotReload(HotReload* reload)
+{
+	// The last seen state of every watched file, to tell which ones changed
+	std::unordered_map<std::string, FileInfo> files;
+	getFileInfo(reload->configPath.c_str(), &files[reload->configPath]);
+	watchDirectory(&reload->watcher, directoryOfPath(reload->configPath));
+
+	while (true) {
+		{
+			std::lock_guard<std::mutex> lock(reload->mutex);
+			if (reload->quit) return;
+			if (reload->imagePathsChanged) {
+				forloop(i, reload->imagePaths.size())
+				{
+					const std::string& path = reload->imagePaths[i];
+					if (!files.count(path)) {
+						getFileInfo(path.c_str(), &files[path]);
+						watchDirectory(&reload->watcher, directoryOfPath(path));
+					}
+				}
+				reload->imagePathsChanged = false;
+			}
+		}
+
+		if (!waitForFileChanges(&reload->watcher, 1000)) continue;
+		// Saving a file can take several writes, so let them settle before reading it
+		forloop(i, 10)
+		{
+			if (!waitForFileChanges(&reload->watcher, 50)) break;
+		}
+
+		bool configChanged = false;
+		std::vector<std::string> changedImages;
+		for (std::unordered_map<std::string, FileInfo>::iterator file = files.begin(); file != files.end(); ++file) {
+			// A missing file is probably being saved by writing another one and renaming it over,
+			// so it's left alone until it's back
+			FileInfo current ={0};
+			if (!getFileInfo(file->first.c_str(), &current)) continue;
+			if (current.modifiedTime != file->second.modifiedTime || current.size != file->second.size) {
+				file->second = current;
+				if (file->first == reload->configPath) configChanged = true;
+				else changedImages.push_back(file->first);
+			}
+		}
+
+		// Only the files that changed are parsed or decoded again.
+		// A config with errors is ignored, keeping the current one, since it's probably still being edited.
+		ConfigSet config;
+		if (configChanged) {
+			std::vector<ConfigError> errors;
+			parseConfigFile(&config, reload->configPath.c_str(), &errors);
+			if (errors.size()) {
+				fprintf(stderr, "%s", formatConfigErrors(reload->configPath.c_str(), errors).c_str());
+				configChanged = false;
+			}
+		}
+		std::vector<TextureCache::Load*> images;
+		forloop(i, changedImages.size())
+		{
+			TextureCache::Load* load = new TextureCache::Load();
+			load->generation = 0;
+			load->path = changedImages[i];
+			load->source = FileInfo();
+			load->contentHash = 0;
+			load->cached = CachedImage();
+			load->decoded = Image();
+			readTextureFile(load, reload->diskCachePath);
+			decodeTextureFile(load, reload->diskCachePath);
+			// An image that can't be decoded right now keeps its current texture
+			if (!load->cached.image.pixels && !load->decoded.pixels) {
+				closeCachedImage(&load->cached);
+				delete load;
+				continue;
+			}
+			images.push_back(load);
+		}
+
+		std::lock_guard<std::mutex> lock(reload->mutex);
+		if (configChanged) {
+			reload->configReloaded = true;
+			reload->reloadedConfig = config;
+		}
+		reload->reloadedImages.insert(reload->reloadedImages.end(), images.begin(), images.end());
+	}
+}
+
+void startHotReload(HotReload* out, const char* configPath, const ConfigSet& config, const TextureCache& textures)
+{
+	out->configPath = configPath;
+	out->diskCachePath = textures.diskCachePath;
+	out->quit = false;
+	out->configReloaded = false;
+	out->configPending = false;
+	createFileWatcher(&out->watcher);
+	setWatchedImages(out, config, textures);
+	out->thread = std::thread(runHotReload, out);
+}
+
+void stopHotReload(HotReload* mod)
+{
+	{
+		std::lock_guard<std::mutex> lock(mod->mutex);
+		mod->quit = true;
+		wakeFileWatcher(&mod->watcher);
+	}
+	mod->thread.join();
+	destroyFileWatcher(&mod->watcher);
+	forloop(i, mod->reloadedImages.size())
+	{
+		closeCachedImage(&mod->reloadedImages[i]->cached);
+		if (mod->reloadedImages[i]->decoded.pixels) freeImage(&mod->reloadedImages[i]->decoded);
+		delete mod->reloadedImages[i];
+	}
+	mod->reloadedImages.clear();
+}
+
+// Pick up finished reloads. Called once per frame on the main thread.
+// Changed images replace their textures right away. A changed config is held back until its images are loaded,
+// then replaces the current one. Returns true when the config was replaced.
+bool applyHotReload(HotReload* mod, ConfigSet* config, TextureCache* textures, JobQueue* jobs)
+{
+	std::vector<TextureCache::Load*> images;
+	bool configReloaded = false;
+	ConfigSet reloadedConfig;
+	{
+		std::lock_guard<std::mutex> lock(mod->mutex);
+		images.swap(mod->reloadedImages);
+		if (mod->configReloaded) {
+			configReloaded = true;
+			reloadedConfig = mod->reloadedConfig;
+			mod->configReloaded = false;
+		}
+	}
+
+	forloop(i, images.size())
+	{
+		TextureCache::Load* load = images[i];
+		std::unordered_map<std::string, uint>::iterator found = textures->entryIndex.find(load->path);
+		if (found != textures->entryIndex.end() && textures->entries[found->second].refCount) {
+			// Any background load of the old file is out of date now
+			load->id = found->second;
+			++textures->entries[load->id].generation;
+			uploadTextureFile(textures, load);
+		}
+		else {
+			closeCachedImage(&load->cached);
+			if (load->decoded.pixels) freeImage(&load->decoded);
+		}
+		delete load;
+	}
+
+	if (configReloaded) {
+		if (mod->configPending) {
+			releaseConfigImages(&mod->pendingConfig, textures);
+		}
+		mod->pendingConfig = reloadedConfig;
+		forloop(profileIndex, mod->pendingConfig.profiles.size())
+		{
+			Config* profile = &mod->pendingConfig.profiles[profileIndex];
+			profile->images.resize(profile->imagePaths.size());
+			forloop(i, profile->imagePaths.size())
+			{
+				uint id = acquireTexture(textures, profile->imagePaths[i]);
+				requestTexture(textures, jobs, id);
+				profile->images[i] = id;
+			}
+		}
+		mod->configPending = true;
+	}
+
+	if (mod->configPending) {
+		forloop(profileIndex, mod->pendingConfig.profiles.size())
+		{
+			const Config& profile = mod->pendingConfig.profiles[profileIndex];
+			forloop(i, profile.images.size())
+			{
+				if (!textures->entries[profile.images[i]].loaded) return false;
+			}
+		}
+		releaseConfigImages(config, textures);
+		*config = mod->pendingConfig;
+		mod->pendingConfig = ConfigSet();
+		mod->configPending = false;
+		setWatchedImages(mod, *config, *textures);
+		return true;
+	}
+	return false;
+}
\ No newline at end of file
@@ -0,0 +1,257 @@
+// Streams joystick input changes and changes to the input list to any number of local clients, so other
+// renderers and loggers can follow the one process that reads the joysticks.
+// Clients connect to a Unix domain socket or a local TCP port and only receive. Each message is a
+// StreamMessage, followed by a null terminated path for Type_image messages, in the writer's native byte order.
+// A new client first gets Type_hello, every image path, and the current lists as Type_listAdd messages
+// oldest first, then the changes made each frame. With --players, each player's list is streamed separately.
+//
+// Messages wait in a bounded buffer for each client. A client that falls so far behind that its buffer
+// fills is disconnected, so a slow client can never hold up the program.
+
+struct StreamMessage
+{
+	enum Type {
+		// index is the protocol version
+		Type_hello,
+		// index is the image id, and the message is followed by its path
+		Type_image,
+		// index is the button, value is 1 if it was pressed or 0 if it was released
+		Type_button,
+		// index is the hat, value is its new SDL hat bits
+		Type_hat,
+		// index is the axis, axisValue is its new position
+		Type_axis,
+		// An input was added to the front of a player's list. joystick is the player, index is the input's id
+		// within that list, value is its image id, and time is when it was read.
+		Type_listAdd,
+		// Inputs were dropped from the back of a player's list. joystick is the player, and index is the number of inputs left.
+		Type_listSize,
+	};
+	static const uint version = 2;
+	// The whole message in bytes, including any path after it
+	unsigned short size;
+	unsigned char type;
+	// For input changes, the index of the joystick. For list changes, the player.
+	unsigned char joystick;
+	uint frameNumber;
+	// In microseconds from an arbitrary starting point
+	uint64 time;
+	uint index;
+	union {
+		uint value;
+		float axisValue;
+	};
+};
+
+struct EventStreamServer
+{
+	struct Client
+	{
+		Socket socket;
+		// Messages not yet sent. Never grows past clientBufferSize.
+		std::vector<unsigned char> pending;
+	};
+	static const uint clientBufferSize = 256*1024;
+	std::vector<Socket> listeners;
+	std::vector<Client> clients;
+	// Removed when the server stops, if listening on a Unix domain socket
+	std::string socketPath;
+	// Messages since the last poll, built once and copied to every client
+	std::vector<unsigned char> frameMessages;
+	// What's been streamed so far
+	uint streamedInsertCounts[PlayerInputs::maxPlayers];
+	uint streamedListSizes[PlayerInputs::maxPlayers];
+	uint streamedImageCount;
+};
+
+// Listen on a local TCP port, a Unix domain socket, or both. Pass 0 for either to not use it.
+bool startEventStreamServer(EventStreamServer* out, uint port, const char* socketPath)
+{
+	startSockets();
+	memset(out->streamedInsertCounts, 0, sizeof(out->streamedInsertCounts));
+	memset(out->streamedListSizes, 0, sizeof(out->streamedListSizes));
+	out->streamedImageCount = 0;
+	out->frameMessages.reserve(EventStreamServer::clientBufferSize);
+	if (port) {
+		Socket listener = listenOnLocalPort(port);
+		if (listener == invalidSocket) return false;
+		out->listeners.push_back(listener);
+	}
+	if (socketPath) {
+		Socket listener = listenOnLocalSocket(socketPath);
+		if (listener == invalidSocket) return false;
+		out->listeners.push_back(listener);
+		out->socketPath = socketPath;
+	}
+	return true;
+}
+
+void stopEventStreamServer(EventStreamServer* mod)
+{
+	forloop(i, mod->clients.size())
+	{
+		closeSocket(mod->clients[i].socket);
+	}
+	mod->clients.clear();
+	forloop(i, mod->listeners.size())
+	{
+		closeSocket(mod->listeners[i]);
+	}
+	mod->listeners.clear();
+	if (mod->socketPath.size()) {
+		remove(mod->socketPath.c_str());
+	}
+}
+
+void addStreamMessage(std::vector<unsigned char>* out, StreamMessage::Type type, uint joystick, uint frameNumber, uint64 time, uint index, uint value, const char* path = 0)
+{
+	StreamMessage message;
+	size_t pathSize = path ? strlen(path)+1 : 0;
+	message.size = (unsigned short)(sizeof(message) + pathSize);
+	message.type = (unsigned char)type;
+	message.joystick = (unsigned char)joystick;
+	message.frameNumber = frameNumber;
+	message.time = time;
+	message.index = index;
+	message.value = value;
+	const unsigned char* bytes = (const unsigned char*)&message;
+	out->insert(out->end(), bytes, bytes + sizeof(message));
+	if (path) out->insert(out->end(), (const unsigned char*)path, (const unsigned char*)path + pathSize);
+}
+
+// Add a message for each button, hat and axis that changed on the last updateInput or injected frame
+void addInputChangeMessages(std::vector<unsigned char>* out, const Input& input, uint frameNumber)
+{
+	forloop(joystickIndex, input.joystickCount)
+	{
+		const Input::Joystick::State& current = input.joysticks[joystickIndex].current;
+		const Input::Joystick::State& previous = input.joysticks[joystickIndex].previous;
+		forloop(i, Input::Joystick::State::buttonCount)
+		{
+			if (current.buttons[i] != previous.buttons[i]) {
+				addStreamMessage(out, StreamMessage::Type_button, joystickIndex, frameNumber, input.pollTime, i, current.buttons[i]);
+			}
+		}
+		if (current.hat != previous.hat) {
+			addStreamMessage(out, StreamMessage::Type_hat, joystickIndex, frameNumber, input.pollTime, 0, (uint)current.hat);
+		}
+		forloop(i, Input::Joystick::State::axisCount)
+		{
+			if (current.axes[i] != previous.axes[i]) {
+				uint value;
+				memcpy(&value, &current.axes[i], sizeof(value));
+				addStreamMessage(out, StreamMessage::Type_axis, joystickIndex, frameNumber, input.pollTime, i, value);
+			}
+		}
+	}
+}
+
+// Add messages for inputs added to the lists since the server last streamed them, oldest first
+void addListMessages(EventStreamServer* mod, const PlayerInputs* players, uint playerCount, const TextureCache& textures, uint frameNumber)
+{
+	std::vector<unsigned char>* out = &mod->frameMessages;
+	for (uint image=mod->streamedImageCount; image<textures.entries.size(); ++image) {
+		addStreamMessage(out, StreamMessage::Type_image, 0, frameNumber, 0, image, 0, textures.entries[image].path.c_str());
+	}
+	mod->streamedImageCount = textures.entries.size();
+
+	forloop(player, playerCount)
+	{
+		const InputDisplayList& list = players[player].list;
+		uint newInputs = std::min(list.insertCount - mod->streamedInsertCounts[player], (uint)list.inputs.size());
+		for (uint i=newInputs; i>0; --i) {
+			const InputDisplay& input = list.inputs[i-1];
+			addStreamMessage(out, StreamMessage::Type_listAdd, player, input.frameNumber, input.inputTime, list.insertCount - i, input.image);
+		}
+		if (list.inputs.size() != mod->streamedListSizes[player] + newInputs) {
+			addStreamMessage(out, StreamMessage::Type_listSize, player, frameNumber, 0, list.inputs.size(), 0);
+		}
+		mod->streamedInsertCounts[player] = list.insertCount;
+		mod->streamedListSizes[player] = list.inputs.size();
+	}
+}
+
+// Everything a new client needs to catch up to the current state
+void addSnapshotMessages(std::vector<unsigned char>* out, const PlayerInputs* players, uint playerCount, const TextureCache& textures, uint frameNumber)
+{
+	addStreamMessage(out, StreamMessage::Type_hello, 0, frameNumber, 0, StreamMessage::version, 0);
+	forloop(image, textures.entries.size())
+	{
+		addStreamMessage(out, StreamMessage::Type_image, 0, frameNumber, 0, image, 0, textures.entries[image].path.c_str());
+	}
+	forloop(player, playerCount)
+	{
+		const InputDisplayList& list = players[player].list;
+		for (uint i=list.inputs.size(); i>0; --i) {
+			const InputDisplay& input = list.inputs[i-1];
+			addStreamMessage(out, StreamMessage::Type_listAdd, player, input.frameNumber, input.inputTime, list.insertCount - i, input.image);
+		}
+	}
+}
+
+// Queue messages for a client, or return false if they don't fit in its buffer
+bool queueStreamMessages(EventStreamServer::Client* client, const std::vector<unsigned char>& messages)
+{
+	if (client->pending.size() + messages.size() > EventStreamServer::clientBufferSize) return false;
+	client->pending.insert(client->pending.end(), messages.begin(), messages.end());
+	return true;
+}
+
+// Send as much as each client will take without blocking. Returns false if the client disconnected.
+bool flushStreamClient(EventStreamServer::Client* client)
+{
+	// Clients aren't expected to send anything, so anything they do is thrown away
+	char ignored[256];
+	int received;
+	while ((received = receiveBytes(client->socket, ignored, sizeof(ignored))) > 0) {}
+	if (received < 0) return false;
+	if (client->pending.empty()) return true;
+	int sent = sendBytes(client->socket, client->pending.data(), client->pending.size());
+	if (sent < 0) return false;
+	client->pending.erase(client->pending.begin(), client->pending.begin() + sent);
+	return true;
+}
+
+// Queue the input changes of one frame. Called for every frame the input is updated, which with injected
+// input can be several per poll.
+void streamInputChanges(EventStreamServer* mod, const Input& input, uint frameNumber)
+{
+	addInputChangeMessages(&mod->frameMessages, input, frameNumber);
+}
+
+// Stream the input changes queued since the last poll and the inputs added to the lists, accept new clients,
+// and send what the connections will take
+void pollEventStreamServer(EventStreamServer* mod, const PlayerInputs* players, uint playerCount, const TextureCache& textures, uint frameNumber)
+{
+	TRACE_SCOPE("pollEventStreamServer");
+	addListMessages(mod, players, playerCount, textures, frameNumber);
+
+	for (uint i=0; i<mod->clients.size();) {
+		EventStreamServer::Client* client = &mod->clients[i];
+		bool keep = queueStreamMessages(client, mod->frameMessages) && flushStreamClient(client);
+		if (keep) {
+			++i;
+		}
+		else {
+			closeSocket(client->socket);
+			mod->clients.erase(mod->clients.begin() + i);
+		}
+	}
+	mod->frameMessages.clear();
+
+	forloop(i, mod->listeners.size())
+	{
+		Socket connection;
+		while ((connection = acceptConnection(mod->listeners[i])) != invalidSocket) {
+			mod->clients.push_back(EventStreamServer::Client());
+			EventStreamServer::Client* client = &mod->clients.back();
+			client->socket = connection;
+			client->pending.reserve(EventStreamServer::clientBufferSize);
+			addSnapshotMessages(&client->pending, players, playerCount, textures, frameNumber);
+			if (client->pending.size() > EventStreamServer::clientBufferSize || !flushStreamClient(client)) {
+				closeSocket(connection);
+				mod->clients.pop_back();
+			}
+		}
+	}
+}
@@ -0,0 +1,367 @@
+#include <unordered_map>
+
+// Every texture used by the program, looked up by image path.
+// Each path is only decoded once, and files with identical contents share one OpenGL texture.
+struct TextureCache
+{
+	// One per distinct file contents
+	struct Data
+	{
+		uint64 contentHash;
+		Texture texture;
+		// Only set when the cache keeps pixels, in place of the texture
+		Image pixels;
+		int width, height;
+		// Number of paths using this data
+		uint refCount;
+	};
+
+	// One per distinct path. Indices into this are the ids handed out by acquireTexture. A released path keeps its
+	// entry, so acquiring it again gets the same id back.
+	struct Entry
+	{
+		std::string path;
+		// Index into datas, or noData if the file hasn't been loaded
+		uint data;
+		uint refCount;
+		bool loaded;
+		// A background load has been started by requestTexture
+		bool loading;
+		// Changed whenever the entry gets an image some other way or is released, so a background load
+		// started before then is out of date when it finishes
+		uint generation;
+	};
+
+	// An image being loaded on a worker thread
+	struct Load
+	{
+		uint id;
+		// The entry's generation when the load started
+		uint generation;
+		std::string path;
+		FileInfo source;
+		std::vector<unsigned char> file;
+		uint64 contentHash;
+		CachedImage cached;
+		Image decoded;
+	};
+
+	static const uint noData = 0xFFFFFFFF;
+	std::vector<Entry> entries;
+	std::vector<Data> datas;
+	std::unordered_map<std::string, uint> entryIndex;
+	std::unordered_map<uint64, uint> dataIndex;
+	std::vector<uint> freeDatas;
+	// Where decoded images are saved between runs. Disabled if empty.
+	std::string diskCachePath;
+	// Leave images unloaded until requestTexture is called for them
+	bool loadOnRequest;
+	// Keep decoded pixels in memory instead of uploading textures, for drawing without OpenGL
+	bool keepPixels;
+
+	// Incremented whenever a texture is uploaded or deleted, so anything holding textures knows to look them up again
+	uint version;
+	// Size of the uploaded image textures or kept pixels, for the performance HUD
+	uint64 textureBytes;
+	// Drawn for images that haven't finished loading in the background
+	Texture placeholder;
+	// Background loads waiting to be uploaded on the main thread
+	std::mutex finishedLoadsMutex;
+	std::vector<Load*> finishedLoads;
+
+	TextureCache() : loadOnRequest(false), keepPixels(false), version(0), textureBytes(0) { placeholder.id = 0; }
+};
+
+// Get the id for an image path, adding a reference to it. The image isn't loaded until loadTextures is called.
+uint acquireTexture(TextureCache* mod, const std::string& path)
+{
+	std::string key = canonicalPath(path.c_str());
+	std::unordered_map<std::string, uint>::iterator found = mod->entryIndex.find(key);
+	if (found != mod->entryIndex.end()) {
+		++mod->entries[found->second].refCount;
+		return found->second;
+	}
+
+	// Ids are never given to another path, so the input list, and programs that were sent the paths,
+	// can't end up showing a different image than they were given
+	TextureCache::Entry entry;
+	entry.path = key;
+	entry.data = TextureCache::noData;
+	entry.refCount = 1;
+	entry.loaded = false;
+	entry.loading = false;
+	entry.generation = 0;
+	mod->entries.push_back(entry);
+	uint id = mod->entries.size()-1;
+	mod->entryIndex[key] = id;
+	return id;
+}
+
+// Add a reference to an image that's already been acquired
+void retainTexture(TextureCache* mod, uint id)
+{
+	++mod->entries[id].refCount;
+}
+
+void releaseTextureData(TextureCache* mod, uint dataIndex)
+{
+	TextureCache::Data* data = &mod->datas[dataIndex];
+	--data->refCount;
+	if (data->refCount == 0) {
+		if (data->texture.id) {
+			mod->textureBytes -= (uint64)data->width*data->height*4;
+			glDeleteTextures(1, &data->texture.id);
+		}
+		if (data->pixels.pixels) {
+			mod->textureBytes -= (uint64)data->width*data->height*4;
+			free(data->pixels.pixels);
+		}
+		++mod->version;
+		mod->dataIndex.erase(data->contentHash);
+		mod->freeDatas.push_back(dataIndex);
+		*data = TextureCache::Data();
+	}
+}
+
+// Remove a reference to an image. When nothing references it any more its texture is deleted, but the entry is
+// kept for when the path is acquired again.
+void releaseTexture(TextureCache* mod, uint id)
+{
+	TextureCache::Entry* entry = &mod->entries[id];
+	--entry->refCount;
+	if (entry->refCount == 0) {
+		if (entry->data != TextureCache::noData) {
+			releaseTextureData(mod, entry->data);
+		}
+		entry->data = TextureCache::noData;
+		entry->loaded = false;
+		entry->loading = false;
+		++entry->generation;
+	}
+}
+
+// Point an entry at the data for some file contents, sharing it if another file had the same contents
+void setTextureData(TextureCache* mod, uint id, uint64 contentHash, Image image)
+{
+	TextureCache::Entry* entry = &mod->entries[id];
+	std::unordered_map<uint64, uint>::iterator found = mod->dataIndex.find(contentHash);
+	uint dataIndex;
+	if (found != mod->dataIndex.end()) {
+		dataIndex = found->second;
+	}
+	else {
+		TextureCache::Data data;
+		data.contentHash = contentHash;
+		data.texture.id = 0;
+		data.pixels = Image();
+		data.width = image.width;
+		data.height = image.height;
+		data.refCount = 0;
+		if (image.pixels) {
+			size_t size = (size_t)image.width*image.height*4;
+			// The image belongs to the caller, so kept pixels are a copy
+			if (mod->keepPixels) {
+				data.pixels = image;
+				data.pixels.pixels = (unsigned char*)malloc(size);
+				memcpy(data.pixels.pixels, image.pixels, size);
+			}
+			else {
+				createTexture(&data.texture, image);
+			}
+			mod->textureBytes += size;
+			++mod->version;
+		}
+		if (mod->freeDatas.size()) {
+			dataIndex = mod->freeDatas.back();
+			mod->freeDatas.pop_back();
+			mod->datas[dataIndex] = data;
+		}
+		else {
+			mod->datas.push_back(data);
+			dataIndex = mod->datas.size()-1;
+		}
+		mod->dataIndex[contentHash] = dataIndex;
+	}
+	++mod->datas[dataIndex].refCount;
+	if (entry->data != TextureCache::noData) {
+		releaseTextureData(mod, entry->data);
+	}
+	entry->data = dataIndex;
+	entry->loaded = true;
+	entry->loading = false;
+}
+
+// First step of loading an image, run on a worker thread.
+// Uses the disk cache if the source file hasn't changed, otherwise reads and hashes the file.
+void readTextureFile(TextureCache::Load* load, const std::string& diskCache)
+{
+	getFileInfo(load->path.c_str(), &load->source);
+	bool haveCached = diskCache.size() && openCachedImage(&load->cached, diskCache, load->path);
+	if (haveCached
+		&& load->cached.header.sourceModifiedTime == load->source.modifiedTime
+		&& load->cached.header.sourceSize == load->source.size)
+	{
+		load->contentHash = load->cached.header.contentHash;
+		return;
+	}
+	readEntireFile(load->path.c_str(), &load->file);
+	load->contentHash = hashBytes(load->file.data(), load->file.size());
+	// The file was touched but its contents are the same, so the cached pixels are still good
+	if (haveCached && load->cached.header.contentHash == load->contentHash) {
+		saveCachedImage(diskCache, load->path, load->source, load->contentHash, load->cached.image);
+		return;
+	}
+	closeCachedImage(&load->cached);
+}
+
+// Second step, also on a worker thread. Decodes the file read by readTextureFile unless the disk cache had it.
+void decodeTextureFile(TextureCache::Load* load, const std::string& diskCache)
+{
+	if (load->cached.image.pixels || !load->file.size()) return;
+	if (loadImageFromMemory(&load->decoded, load->file.data(), load->file.size()) && diskCache.size()) {
+		saveCachedImage(diskCache, load->path, load->source, load->contentHash, load->decoded);
+	}
+}
+
+// Last step, on the main thread
+void uploadTextureFile(TextureCache* mod, TextureCache::Load* load)
+{
+	setTextureData(mod, load->id, load->contentHash, load->cached.image.pixels ? load->cached.image : load->decoded);
+	closeCachedImage(&load->cached);
+	if (load->decoded.pixels) {
+		freeImage(&load->decoded);
+	}
+}
+
+TextureCache::Load startTextureLoad(const TextureCache& cache, uint id)
+{
+	TextureCache::Load result;
+	result.id = id;
+	result.generation = cache.entries[id].generation;
+	result.path = cache.entries[id].path;
+	result.source = FileInfo();
+	result.contentHash = 0;
+	result.cached = CachedImage();
+	result.decoded = Image();
+	return result;
+}
+
+// Load every acquired image that hasn't been loaded yet, blocking until they're uploaded.
+// Files are read and hashed in parallel first, so contents seen before skip decoding. The rest are decoded in parallel.
+void loadTextures(TextureCache* mod, JobQueue* jobs)
+{
+	std::vector<TextureCache::Load> pending;
+	forloop(id, mod->entries.size())
+	{
+		if (mod->entries[id].refCount && !mod->entries[id].loaded && !mod->entries[id].loading) {
+			pending.push_back(startTextureLoad(*mod, id));
+		}
+	}
+
+	const std::string& diskCache = mod->diskCachePath;
+	if (diskCache.size()) {
+		createDirectory(diskCache.c_str());
+	}
+	forloop(i, pending.size())
+	{
+		TextureCache::Load* load = &pending[i];
+		addJob(jobs, [load, &diskCache]{ readTextureFile(load, diskCache); });
+	}
+	waitForJobs(jobs);
+
+	// Only decode the first file with each hash. A missing file hashes like an empty one and decodes to nothing.
+	std::unordered_map<uint64, uint> firstWithHash;
+	forloop(i, pending.size())
+	{
+		TextureCache::Load* load = &pending[i];
+		bool alreadyLoaded = mod->dataIndex.count(load->contentHash) != 0;
+		bool firstSeen = firstWithHash.insert(std::make_pair(load->contentHash, i)).second;
+		if (!alreadyLoaded && firstSeen) {
+			addJob(jobs, [load, &diskCache]{ decodeTextureFile(load, diskCache); });
+		}
+	}
+	waitForJobs(jobs);
+
+	forloop(i, pending.size())
+	{
+		uploadTextureFile(mod, &pending[i]);
+	}
+}
+
+// Start loading an image in the background if it isn't loaded yet. Never blocks.
+// The placeholder is drawn in its place until uploadFinishedTextures picks it up.
+void requestTexture(TextureCache* mod, JobQueue* jobs, uint id)
+{
+	TextureCache::Entry* entry = &mod->entries[id];
+	if (entry->loaded || entry->loading) return;
+	entry->loading = true;
+	if (mod->diskCachePath.size()) {
+		createDirectory(mod->diskCachePath.c_str());
+	}
+	TextureCache::Load* load = new TextureCache::Load(startTextureLoad(*mod, id));
+	// The cache's strings can change while the job runs, so it works from copies
+	std::string diskCache = mod->diskCachePath;
+	addJob(jobs, [mod, load, diskCache]{
+		readTextureFile(load, diskCache);
+		decodeTextureFile(load, diskCache);
+		std::lock_guard<std::mutex> lock(mod->finishedLoadsMutex);
+		mod->finishedLoads.push_back(load);
+	});
+}
+
+// Upload images whose background loads have finished. Called once per frame on the main thread.
+void uploadFinishedTextures(TextureCache* mod)
+{
+	TRACE_SCOPE("uploadFinishedTextures");
+	std::vector<TextureCache::Load*> finished;
+	{
+		std::lock_guard<std::mutex> lock(mod->finishedLoadsMutex);
+		finished.swap(mod->finishedLoads);
+	}
+	forloop(i, finished.size())
+	{
+		// The image may have been released or hot reloaded while it was loading
+		if (finished[i]->generation == mod->entries[finished[i]->id].generation) {
+			uploadTextureFile(mod, finished[i]);
+		}
+		else {
+			closeCachedImage(&finished[i]->cached);
+			if (finished[i]->decoded.pixels) freeImage(&finished[i]->decoded);
+		}
+		delete finished[i];
+	}
+}
+
+void createPlaceholderTexture(TextureCache* mod)
+{
+	// A faint grey square, premultiplied
+	unsigned char pixel[4] ={40, 40, 40, 80};
+	Image image;
+	image.pixels = pixel;
+	image.width = 1;
+	image.height = 1;
+	createTexture(&mod->placeholder, image);
+}
+
+// Get the id for an image path whose pixels were decoded elsewhere, uploading them if the path or contents aren't loaded yet
+uint acquireDecodedTexture(TextureCache* mod, const std::string& path, uint64 contentHash, Image image)
+{
+	uint id = acquireTexture(mod, path);
+	if (!mod->entries[id].loaded) {
+		setTextureData(mod, id, contentHash, image);
+	}
+	return id;
+}
+
+Texture getTexture(const TextureCache& cache, uint id)
+{
+	Texture result ={0};
+	const TextureCache::Entry& entry = cache.entries[id];
+	if (entry.loaded) {
+		result = cache.datas[entry.data].texture;
+	}
+	else if (entry.loading) {
+		result = cache.placeholder;
+	}
+	return result;
+}
\ No newline at end of file
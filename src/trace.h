@@ -0,0 +1,142 @@
+#include <atomic>
+#include <mutex>
+#include <signal.h>
+#include <algorithm>
+
+// Records how long each phase of a frame takes, for finding the cause of stutters.
+// Each thread writes to its own ring of recent events without locking, and the rings can be saved
+// in Chrome's trace event format to view in chrome://tracing or Perfetto.
+// When tracing is off, a TRACE_SCOPE only costs checking a flag.
+
+struct TraceEvent
+{
+	// Must be a string literal, since only the pointer is kept
+	const char* name;
+	uint64 start;
+	uint64 duration;
+};
+
+struct TraceRing
+{
+	static const uint capacity = 1 << 14;
+	TraceEvent events[capacity];
+	// Total events ever written. Only the owning thread writes, so it can publish without locking.
+	std::atomic<uint64> written;
+	uint threadId;
+};
+
+struct Tracer
+{
+	std::atomic<bool> enabled;
+	// Every thread's ring. Rings are only added, and live until the program exits.
+	std::mutex ringsMutex;
+	std::vector<TraceRing*> rings;
+};
+
+Tracer tracer;
+thread_local TraceRing* threadTraceRing = 0;
+
+TraceRing* getThreadTraceRing()
+{
+	if (!threadTraceRing) {
+		TraceRing* ring = new TraceRing;
+		ring->written.store(0);
+		std::lock_guard<std::mutex> lock(tracer.ringsMutex);
+		ring->threadId = tracer.rings.size();
+		tracer.rings.push_back(ring);
+		threadTraceRing = ring;
+	}
+	return threadTraceRing;
+}
+
+void recordTraceEvent(const char* name, uint64 start, uint64 end)
+{
+	TraceRing* ring = getThreadTraceRing();
+	uint64 index = ring->written.load(std::memory_order_relaxed);
+	TraceEvent* event = &ring->events[index % TraceRing::capacity];
+	event->name = name;
+	event->start = start;
+	event->duration = end - start;
+	ring->written.store(index+1, std::memory_order_release);
+}
+
+struct TraceScope
+{
+	const char* name;
+	uint64 start;
+	TraceScope(const char* name) : name(name), start(tracer.enabled.load(std::memory_order_relaxed) ? getMicroseconds() : 0) {}
+	~TraceScope()
+	{
+		if (start) recordTraceEvent(name, start, getMicroseconds());
+	}
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+// Time the rest of the enclosing scope
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+// Copy out the events a ring holds. Its thread may keep writing meanwhile, so events it could have
+// overwritten during the copy are left out.
+void copyTraceEvents(TraceRing* ring, std::vector<TraceEvent>* out)
+{
+	uint64 end = ring->written.load(std::memory_order_acquire);
+	uint64 begin = end > TraceRing::capacity ? end - TraceRing::capacity : 0;
+	size_t firstCopied = out->size();
+	for (uint64 i=begin; i<end; ++i) {
+		out->push_back(ring->events[i % TraceRing::capacity]);
+	}
+	uint64 writtenAfter = ring->written.load(std::memory_order_acquire);
+	uint64 firstSafe = writtenAfter > TraceRing::capacity ? writtenAfter - TraceRing::capacity : 0;
+	if (firstSafe > begin) {
+		out->erase(out->begin() + firstCopied, out->begin() + firstCopied + (size_t)std::min(firstSafe - begin, end - begin));
+	}
+}
+
+// Write every thread's recorded events as Chrome trace event JSON
+bool saveTrace(const char* filePath)
+{
+	FILE* file = fopen(filePath, "w");
+	if (!file) return false;
+	std::vector<TraceRing*> rings;
+	{
+		std::lock_guard<std::mutex> lock(tracer.ringsMutex);
+		rings = tracer.rings;
+	}
+	fprintf(file, "{\"traceEvents\":[\n");
+	bool first = true;
+	std::vector<TraceEvent> events;
+	forloop(ringIndex, rings.size())
+	{
+		events.clear();
+		copyTraceEvents(rings[ringIndex], &events);
+		forloop(i, events.size())
+		{
+			fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%llu,\"dur\":%llu}",
+				first ? "" : ",\n", events[i].name, rings[ringIndex]->threadId, events[i].start, events[i].duration);
+			first = false;
+		}
+	}
+	fprintf(file, "\n]}\n");
+	bool written = !ferror(file);
+	fclose(file);
+	return written;
+}
+
+// Set by SIGUSR1 to ask for the trace to be saved. Checked by the main loop, since a signal handler can't safely write files.
+volatile sig_atomic_t traceSaveRequested = 0;
+
+#ifdef SIGUSR1
+void requestTraceSave(int)
+{
+	traceSaveRequested = 1;
+}
+#endif
+
+void startTracing()
+{
+	tracer.enabled.store(true);
+#ifdef SIGUSR1
+	signal(SIGUSR1, requestTraceSave);
+#endif
+}